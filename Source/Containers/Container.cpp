@@ -1,6 +1,10 @@
 #include "Containers/Container.h"
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <cwchar>
+#endif
 
 FAString FStringUtils::WStringToAString(const FWString& SrcString)
 {
@@ -16,7 +20,21 @@ FAString FStringUtils::WStringToAString(const FWString& SrcString)
 
     return Result;
 #else
-    return "Only support Windows platform";
+    // Only the headless build runs elsewhere. The C library converts with the current locale, and characters it cannot
+    // represent leave the result empty.
+    std::mbstate_t State{};
+    const FWChar* Source = SrcString.c_str();
+    std::size_t StrLen = std::wcsrtombs(nullptr, &Source, 0, &State);
+    if (StrLen == (std::size_t)-1)
+    {
+        return FAString();
+    }
+
+    FAString Result(StrLen, '\0');
+    Source = SrcString.c_str();
+    State = std::mbstate_t{};
+    std::wcsrtombs(Result.data(), &Source, StrLen, &State);
+    return Result;
 #endif
 }
 
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 
+#ifdef _MSC_VER
 #define FORCEINLINE __forceinline
+#else
+#define FORCEINLINE inline __attribute__((always_inline))
+#endif
 
 using uint8 = std::uint8_t;
 using uint32 = std::uint32_t;
+using uint64 = std::uint64_t;
 
 using int32 = std::int32_t;
+using int64 = std::int64_t;
 
 #pragma warning(disable : 4819)
@@ -1,5 +1,8 @@
 #include "Geometry/BoundingBox.h"
 #include "RayTracing/Ray.h"
+#include "RayTracing/RayPacket.h"
+
+#include <xmmintrin.h>
 
 FBoundingBox::FBoundingBox() : MinPoint(FVector(FLOAT_MAX)), MaxPoint(FVector(FLOAT_MIN)) {}
 
@@ -100,3 +103,66 @@ bool FBoundingBox::IsIntersecting(const FRay& Ray) const
 
     return TimeEnter <= TimeExit && TimeExit >= 0.0f;
 }
+
+uint32 FBoundingBox::IsIntersecting(const FRayPacket& Packet, uint32 ActiveMask) const
+{
+    if (Packet.bCoherent && !MayIntersect(Packet))
+    {
+        return 0;
+    }
+
+    // The same operations as the single-ray test, four lanes at a time. _mm_max_ps / _mm_min_ps pick the same operand
+    // as FMath::Max / FMath::Min, also for NaNs, so every lane matches the single-ray result bit for bit.
+    uint32 HitMask = 0;
+    for (int32 Lane = 0; Lane < RayPacketSize; Lane += 4)
+    {
+        if (((ActiveMask >> Lane) & 0xF) == 0)
+        {
+            continue;
+        }
+
+        __m128 TimeEnter = _mm_set1_ps(FLOAT_MIN);
+        __m128 TimeExit = _mm_set1_ps(FLOAT_MAX);
+        for (int32 Axis = 0; Axis < 3; ++Axis)
+        {
+            __m128 Origin = _mm_load_ps(Packet.Origin[Axis] + Lane);
+            __m128 Direction = _mm_load_ps(Packet.Direction[Axis] + Lane);
+            __m128 Tmin = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(MinPoint[Axis]), Origin), Direction);
+            __m128 Tmax = _mm_div_ps(_mm_sub_ps(_mm_set1_ps(MaxPoint[Axis]), Origin), Direction);
+
+            __m128 Negative = _mm_cmplt_ps(Direction, _mm_setzero_ps());
+            __m128 Near = _mm_or_ps(_mm_and_ps(Negative, Tmax), _mm_andnot_ps(Negative, Tmin));
+            __m128 Far = _mm_or_ps(_mm_and_ps(Negative, Tmin), _mm_andnot_ps(Negative, Tmax));
+
+            TimeEnter = _mm_max_ps(TimeEnter, Near);
+            TimeExit = _mm_min_ps(TimeExit, Far);
+        }
+
+        __m128 Hit = _mm_and_ps(_mm_cmple_ps(TimeEnter, TimeExit), _mm_cmpge_ps(TimeExit, _mm_setzero_ps()));
+        HitMask |= (uint32)_mm_movemask_ps(Hit) << Lane;
+    }
+    return HitMask & ActiveMask;
+}
+
+bool FBoundingBox::MayIntersect(const FRayPacket& Packet) const
+{
+    // Interval arithmetic over the packet's origins and (mirrored, positive) directions bounds every ray's entry time from
+    // below and exit time from above. Rounding is monotonic, so the bounds also hold for the rounded per-ray values.
+    float TimeEnter = FLOAT_MIN;
+    float TimeExit = FLOAT_MAX;
+    for (int32 Axis = 0; Axis < 3; ++Axis)
+    {
+        float Near = Packet.bNegativeAxis[Axis] ? -MaxPoint[Axis] : MinPoint[Axis];
+        float Far = Packet.bNegativeAxis[Axis] ? -MinPoint[Axis] : MaxPoint[Axis];
+
+        float NearDistance = Near - Packet.MaxOrigin[Axis];
+        float FarDistance = Far - Packet.MinOrigin[Axis];
+        float Tmin = NearDistance / (NearDistance >= 0.0f ? Packet.MaxDirection[Axis] : Packet.MinDirection[Axis]);
+        float Tmax = FarDistance / (FarDistance >= 0.0f ? Packet.MinDirection[Axis] : Packet.MaxDirection[Axis]);
+
+        TimeEnter = FMath::Max(TimeEnter, Tmin);
+        TimeExit = FMath::Min(TimeExit, Tmax);
+    }
+
+    return TimeEnter <= TimeExit && TimeExit >= 0.0f;
+}
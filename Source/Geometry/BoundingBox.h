@@ -3,6 +3,7 @@
 #include "CoreTypes.h"
 
 struct FRay;
+struct FRayPacket;
 
 struct FBoundingBox
 {
@@ -33,4 +34,10 @@ public:
     float SurfaceArea() const;
 
     bool IsIntersecting(const FRay& Ray) const;
+    // Bit i of the result is set if ray i of ActiveMask intersects the box, exactly as the single-ray test decides.
+    uint32 IsIntersecting(const FRayPacket& Packet, uint32 ActiveMask) const;
+
+private:
+    // Conservative test for a coherent packet: false only if no ray of the packet can intersect the box.
+    bool MayIntersect(const FRayPacket& Packet) const;
 };
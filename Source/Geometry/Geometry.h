@@ -1,9 +1,12 @@
 #pragma once
 
 #include "CoreTypes.h"
+#include "RayTracing/RayPacket.h"
 
 struct FBoundingBox;
+struct FHitRecord;
 struct FHitResult;
+struct FLightBounds;
 struct FRay;
 
 class FGeometry
@@ -17,6 +20,37 @@ public:
     virtual bool IsEmission() const = 0;
 
     virtual void BuildBVH() {}
-    virtual void LineTrace(FHitResult& OutHitResult, const FRay& Ray) = 0;
-    virtual void Sample(FHitResult& OutHitResult, float& OutPdf) = 0;
+
+    // Collect the emissive leaf primitives (triangles) of this geometry. Valid after BuildBVH.
+    virtual void GatherEmissivePrimitives(TArray<FGeometry*>& OutPrimitives)
+    {
+        if (IsEmission())
+        {
+            OutPrimitives.emplace_back(this);
+        }
+    }
+
+    // Spatial and directional bounds of the light this primitive emits, for the light BVH. False if it has none to offer,
+    // the BVH then falls back to its bounding box and omnidirectional emission.
+    virtual bool GetLightBounds(FLightBounds& OutBounds) const { return false; }
+
+    // Closest-hit traversal: replace InOutRecord if the ray hits no farther than InOutRecord.Time. Of equally close hits
+    // the one traced last wins.
+    virtual void LineTrace(FHitRecord& InOutRecord, const FRay& Ray) = 0;
+    // Trace the rays of Packet selected by ActiveMask into Packet.Hits. By default one ray at a time.
+    virtual void LineTracePacket(FRayPacket& Packet, uint32 ActiveMask)
+    {
+        for (int32 Index = 0; Index < Packet.Num; ++Index)
+        {
+            if (ActiveMask & (1u << Index))
+            {
+                LineTrace(Packet.Hits[Index], Packet.Rays[Index]);
+            }
+        }
+    }
+    // Position, normals, texture coordinates and material of a hit recorded by this primitive.
+    // Only leaf primitives end up in a FHitRecord, so containers keep the empty default.
+    virtual void GetSurfaceInteraction(const FHitRecord& Record, FHitResult& OutHitResult) {}
+    // Sample a point uniformly on the surface from two uniform random numbers.
+    virtual void Sample(FHitResult& OutHitResult, float& OutPdf, const FVector2& U) = 0;
 };
@@ -59,9 +59,11 @@ void FMesh::ApplyTransform(const FVector& InTranslation, const FVector& InRotati
     SetTransform(InTranslation, InRotation, InScale);
     UpdateModelMatrix();
 
+    // Normals only follow rotation and uniform scale.
     for (FVertex& Vertex : Vertices)
     {
         Vertex.Position = (ModelMatrix * FVector4(Vertex.Position, 1.0f)).ToVector3();
+        Vertex.Normal = (ModelMatrix * FVector4(Vertex.Normal, 0.0f)).ToVector3().GetSafeNormal();
     }
 }
 
@@ -72,9 +74,19 @@ bool FMesh::IsEmission() const
 
 void FMesh::BuildBVH()
 {
+    // The rasterizer reads the mesh texture directly. Ray traced hits only see their material, so it gets a copy with
+    // the texture.
+    FMaterial* PrimitiveMaterial = Material;
+    if (Texture != nullptr && Material != nullptr && Material->AlbedoTexture == nullptr)
+    {
+        TexturedMaterial = new FMaterial(*Material);
+        TexturedMaterial->AlbedoTexture = Texture;
+        PrimitiveMaterial = TexturedMaterial;
+    }
+
     for (const FVector3i& Index : Indices)
     {
-        FTriangle* Triangle = new FTriangle(Vertices[Index.X], Vertices[Index.Y], Vertices[Index.Z], Material);
+        FTriangle* Triangle = new FTriangle(Vertices[Index.X], Vertices[Index.Y], Vertices[Index.Z], PrimitiveMaterial);
         BoundingBox |= Triangle->GetBoundingBox();
         Area += Triangle->GetArea();
         RTPrimitives.emplace_back(Triangle);
@@ -84,17 +96,33 @@ void FMesh::BuildBVH()
     // BVH->Print();
 }
 
-void FMesh::LineTrace(FHitResult& OutHitResult, const FRay& Ray)
+void FMesh::GatherEmissivePrimitives(TArray<FGeometry*>& OutPrimitives)
+{
+    for (FGeometry* Primitive : RTPrimitives)
+    {
+        Primitive->GatherEmissivePrimitives(OutPrimitives);
+    }
+}
+
+void FMesh::LineTrace(FHitRecord& InOutRecord, const FRay& Ray)
 {
     if (BVH != nullptr)
     {
-        BVH->LineTrace(OutHitResult, Ray);
+        BVH->LineTrace(InOutRecord, Ray);
     }
 }
 
-void FMesh::Sample(FHitResult& OutHitResult, float& OutPdf)
+void FMesh::LineTracePacket(FRayPacket& Packet, uint32 ActiveMask)
 {
-    BVH->Sample(OutHitResult, OutPdf);
+    if (BVH != nullptr)
+    {
+        BVH->LineTracePacket(Packet, ActiveMask);
+    }
+}
+
+void FMesh::Sample(FHitResult& OutHitResult, float& OutPdf, const FVector2& U)
+{
+    BVH->Sample(OutHitResult, OutPdf, U);
 }
 
 void FMesh::DestroyBVH() noexcept
@@ -114,4 +142,10 @@ void FMesh::DestroyBVH() noexcept
             Primitive = nullptr;
         }
     }
+
+    if (TexturedMaterial != nullptr)
+    {
+        delete TexturedMaterial;
+        TexturedMaterial = nullptr;
+    }
 }
@@ -67,8 +67,10 @@ public:
     virtual bool IsEmission() const override;
 
     virtual void BuildBVH() override;
-    virtual void LineTrace(FHitResult& OutHitResult, const FRay& Ray) override;
-    virtual void Sample(FHitResult& OutHitResult, float& OutPdf) override;
+    virtual void GatherEmissivePrimitives(TArray<FGeometry*>& OutPrimitives) override;
+    virtual void LineTrace(FHitRecord& InOutRecord, const FRay& Ray) override;
+    virtual void LineTracePacket(FRayPacket& Packet, uint32 ActiveMask) override;
+    virtual void Sample(FHitResult& OutHitResult, float& OutPdf, const FVector2& U) override;
 
 private:
     void DestroyBVH() noexcept;
@@ -77,6 +79,8 @@ private:
     FBoundingVolumeHierarchy* BVH = nullptr;
 
     TArray<struct FGeometry*> RTPrimitives;
+    // Material with the mesh texture as its albedo texture, if the material has none of its own.
+    FMaterial* TexturedMaterial = nullptr;
     FBoundingBox BoundingBox;
     float Area = 0.0f;
 };
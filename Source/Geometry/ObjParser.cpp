@@ -3,6 +3,7 @@
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <filesystem>
 
 enum class EVertexType
 {
@@ -15,7 +16,7 @@ enum class EVertexType
 FMesh FObjParser::Parse(const FString& FilePath)
 {
     FMesh Mesh;
-    FFileStream ObjFile(FilePath);
+    FFileStream ObjFile{::std::filesystem::path(FilePath)};
 
     if (ObjFile.is_open())
     {
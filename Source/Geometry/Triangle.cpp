@@ -2,9 +2,12 @@
 
 #include "Geometry/BoundingBox.h"
 #include "RayTracing/HitResult.h"
+#include "RayTracing/LightBVH.h"
 #include "RayTracing/Ray.h"
 #include "Material/Material.h"
 
+bool FTriangle::bWatertight = true;
+
 FTriangle::FTriangle(const FVertex& InA, const FVertex& InB, const FVertex& InC, FMaterial* InMaterial)
     : A(InA), B(InB), C(InC), Material(InMaterial)
 {
@@ -12,6 +15,12 @@ FTriangle::FTriangle(const FVertex& InA, const FVertex& InB, const FVertex& InC,
     FVector E2 = C.Position - A.Position;
     Normal = FVector::CrossProduct(E1, E2).GetSafeNormal();
     Area = 0.5f * FVector::CrossProduct(E1, E2).Length();
+    bSmoothShading = !(A.Normal == B.Normal && A.Normal == C.Normal);
+
+    FVector2 T1 = B.TexCoord - A.TexCoord;
+    FVector2 T2 = C.TexCoord - A.TexCoord;
+    float TexCoordArea = 0.5f * FMath::Abs(T1.X * T2.Y - T1.Y * T2.X);
+    TexCoordDensity = Area > 0.0f ? FMath::Sqrt(TexCoordArea / Area) : 0.0f;
 }
 
 FBoundingBox FTriangle::GetBoundingBox() const
@@ -29,60 +38,190 @@ bool FTriangle::IsEmission() const
     return Material == nullptr ? false : Material->IsEmission();
 }
 
-void FTriangle::LineTrace(FHitResult& OutHitResult, const FRay& Ray)
+bool FTriangle::GetLightBounds(FLightBounds& OutBounds) const
+{
+    if (!IsEmission())
+    {
+        return false;
+    }
+
+    // One-sided emission around the geometric normal, weighted by the luminance of the emitted power.
+    const FVector& Emission = Material->Emission;
+    OutBounds.Bounds = GetBoundingBox();
+    OutBounds.Axis = Normal;
+    OutBounds.CosThetaO = 1.0f;
+    OutBounds.CosThetaE = 0.0f;
+    OutBounds.Phi = (0.2126f * Emission.X + 0.7152f * Emission.Y + 0.0722f * Emission.Z) * Area;
+    return true;
+}
+
+void FTriangle::LineTrace(FHitRecord& InOutRecord, const FRay& Ray)
 {
-    if (FVector::DotProduct(Ray.Direction, Normal) < 0.0f)
+    // Triangles are single-sided.
+    if (FVector::DotProduct(Ray.Direction, Normal) >= 0.0f)
     {
-        // Möller–Trumbore:
-        // O + t * d = (1 - u - v) * P0 + u * P1 + v * P2
-        // => O - P0 = (P1 - P0) * u + (P2 - P0) * v - t * d
-        // => S      = E1 * u        + E2 * v        - t * d
-        //                   | t |
-        // => S = [-d E1 E2] | u |
-        //                   | v |
-        // => t = det([S E1 E2]) / det([-d E1 E2])
-        //        (S x E1) · E2
-        // => t = --------------
-        //        E1 · (d x E2)
-        // => t = (S2 · E2) / (S1 · E1)
-        //
-        // u = (S1 · S) / (S1 · E1)
-        // v = (S2 · d) / (S1 · E1)
-
-        FVector E1 = B.Position - A.Position;
-        FVector E2 = C.Position - A.Position;
-        FVector S1 = FVector::CrossProduct(Ray.Direction, E2);
-        float Det = FVector::DotProduct(S1, E1);
-        if (FMath::Abs(Det) > KINDA_SMALL_NUMBER)
+        return;
+    }
+
+    float T = 0.0f;
+    FVector Barycentrics;
+    bool bHit = bWatertight ? IntersectWatertight(Ray, T, Barycentrics) : IntersectMollerTrumbore(Ray, T, Barycentrics);
+    if (bHit && T <= InOutRecord.Time)
+    {
+        InOutRecord.Time = T;
+        InOutRecord.Barycentrics = Barycentrics;
+        InOutRecord.Primitive = this;
+    }
+}
+
+void FTriangle::GetSurfaceInteraction(const FHitRecord& Record, FHitResult& OutHitResult)
+{
+    const FVector& Weights = Record.Barycentrics;
+
+    OutHitResult.bHit = true;
+    OutHitResult.Time = Record.Time;
+    // Interpolating the vertices is more accurate than O + t * d, and keeps the point on the triangle's plane.
+    OutHitResult.Location = Weights.X * A.Position + Weights.Y * B.Position + Weights.Z * C.Position;
+    OutHitResult.Normal = Normal;
+    OutHitResult.ShadingNormal = Normal;
+    if (bSmoothShading)
+    {
+        FVector ShadingNormal = (Weights.X * A.Normal + Weights.Y * B.Normal + Weights.Z * C.Normal).GetSafeNormal();
+        if (ShadingNormal != FVector::ZeroVector)
         {
-            FVector S = Ray.Origin - A.Position;
-            FVector S2 = FVector::CrossProduct(S, E1);
-
-            float DetInv = 1.0f / Det;
-            float T = DetInv * FVector::DotProduct(S2, E2);
-            float U = DetInv * FVector::DotProduct(S1, S);
-            float V = DetInv * FVector::DotProduct(S2, Ray.Direction);
-
-            if (T >= 0 && U >= 0.0f && V >= 0.0f && U + V <= 1.0f)
-            {
-                OutHitResult.bHit = true;
-                OutHitResult.Time = T;
-                OutHitResult.Location = Ray.GetLocation(T);
-                OutHitResult.Normal = Normal;
-                OutHitResult.Object = this;
-                OutHitResult.Material = Material;
-            }
+            OutHitResult.ShadingNormal = FVector::DotProduct(ShadingNormal, Normal) < 0.0f ? -ShadingNormal : ShadingNormal;
         }
     }
+    OutHitResult.TexCoord = Weights.X * A.TexCoord + Weights.Y * B.TexCoord + Weights.Z * C.TexCoord;
+    OutHitResult.TexCoordDensity = TexCoordDensity;
+    OutHitResult.Object = this;
+    OutHitResult.Material = Material;
 }
-void FTriangle::Sample(FHitResult& OutHitResult, float& OutPdf)
+
+bool FTriangle::IntersectWatertight(const FRay& Ray, float& OutTime, FVector& OutBarycentrics) const
+{
+    // Woop, Benthin and Wald 2013, "Watertight Ray/Triangle Intersection".
+    // Shear and scale the triangle into a space where the ray starts at the origin and runs along +Z. Then the hit test
+    // is the sign of three 2D edge functions. Triangles sharing an edge evaluate it with the same operands, so a ray
+    // through the edge hits at least one of them: no cracks. There is no determinant cutoff that misses small triangles.
+    const FVector& Direction = Ray.Direction;
+    int32 Kz = FMath::Abs(Direction.X) > FMath::Abs(Direction.Y) ? (FMath::Abs(Direction.X) > FMath::Abs(Direction.Z) ? 0 : 2)
+                                                                   : (FMath::Abs(Direction.Y) > FMath::Abs(Direction.Z) ? 1 : 2);
+    int32 Kx = (Kz + 1) % 3;
+    int32 Ky = (Kx + 1) % 3;
+    // Keep the winding, so the sign of the edge functions still tells the facing.
+    if (Direction[Kz] < 0.0f)
+    {
+        FMath::Swap(Kx, Ky);
+    }
+
+    float Sx = Direction[Kx] / Direction[Kz];
+    float Sy = Direction[Ky] / Direction[Kz];
+    float Sz = 1.0f / Direction[Kz];
+
+    FVector PA = A.Position - Ray.Origin;
+    FVector PB = B.Position - Ray.Origin;
+    FVector PC = C.Position - Ray.Origin;
+
+    float Ax = PA[Kx] - Sx * PA[Kz];
+    float Ay = PA[Ky] - Sy * PA[Kz];
+    float Bx = PB[Kx] - Sx * PB[Kz];
+    float By = PB[Ky] - Sy * PB[Kz];
+    float Cx = PC[Kx] - Sx * PC[Kz];
+    float Cy = PC[Ky] - Sy * PC[Kz];
+
+    float U = Cx * By - Cy * Bx;
+    float V = Ax * Cy - Ay * Cx;
+    float W = Bx * Ay - By * Ax;
+
+    // Exactly on an edge the float products may have cancelled: decide in double precision.
+    if (U == 0.0f || V == 0.0f || W == 0.0f)
+    {
+        U = (float)((double)Cx * By - (double)Cy * Bx);
+        V = (float)((double)Ax * Cy - (double)Ay * Cx);
+        W = (float)((double)Bx * Ay - (double)By * Ax);
+    }
+
+    if ((U < 0.0f || V < 0.0f || W < 0.0f) && (U > 0.0f || V > 0.0f || W > 0.0f))
+    {
+        return false;
+    }
+
+    float Det = U + V + W;
+    if (Det == 0.0f)
+    {
+        return false;
+    }
+
+    // Distance times Det, so the sign test needs no division.
+    float ScaledTime = Sz * (U * PA[Kz] + V * PB[Kz] + W * PC[Kz]);
+    if (Det < 0.0f ? ScaledTime > 0.0f : ScaledTime < 0.0f)
+    {
+        return false;
+    }
+
+    float InvDet = 1.0f / Det;
+    OutTime = ScaledTime * InvDet;
+    OutBarycentrics = FVector(U * InvDet, V * InvDet, W * InvDet);
+    return true;
+}
+
+bool FTriangle::IntersectMollerTrumbore(const FRay& Ray, float& OutTime, FVector& OutBarycentrics) const
+{
+    // Möller–Trumbore:
+    // O + t * d = (1 - u - v) * P0 + u * P1 + v * P2
+    // => O - P0 = (P1 - P0) * u + (P2 - P0) * v - t * d
+    // => S      = E1 * u        + E2 * v        - t * d
+    //                   | t |
+    // => S = [-d E1 E2] | u |
+    //                   | v |
+    // => t = det([S E1 E2]) / det([-d E1 E2])
+    //        (S x E1) · E2
+    // => t = --------------
+    //        E1 · (d x E2)
+    // => t = (S2 · E2) / (S1 · E1)
+    //
+    // u = (S1 · S) / (S1 · E1)
+    // v = (S2 · d) / (S1 · E1)
+
+    FVector E1 = B.Position - A.Position;
+    FVector E2 = C.Position - A.Position;
+    FVector S1 = FVector::CrossProduct(Ray.Direction, E2);
+    float Det = FVector::DotProduct(S1, E1);
+    if (FMath::Abs(Det) <= KINDA_SMALL_NUMBER)
+    {
+        return false;
+    }
+
+    FVector S = Ray.Origin - A.Position;
+    FVector S2 = FVector::CrossProduct(S, E1);
+
+    float DetInv = 1.0f / Det;
+    float T = DetInv * FVector::DotProduct(S2, E2);
+    float U = DetInv * FVector::DotProduct(S1, S);
+    float V = DetInv * FVector::DotProduct(S2, Ray.Direction);
+    if (T < 0 || U < 0.0f || V < 0.0f || U + V > 1.0f)
+    {
+        return false;
+    }
+
+    OutTime = T;
+    OutBarycentrics = FVector(1.0f - U - V, U, V);
+    return true;
+}
+
+void FTriangle::Sample(FHitResult& OutHitResult, float& OutPdf, const FVector2& U)
 {
-    float R1 = FMath::RandomFloat();
-    float R2 = FMath::RandomFloat();
+    // The square root makes the barycentrics uniform over the area of the triangle.
+    float R1 = FMath::Sqrt(U.X);
+    float R2 = U.Y;
 
     OutHitResult.bHit = true;
     OutHitResult.Location = (1 - R1) * A.Position + (R1 * (1 - R2)) * B.Position + (R1 * R2) * C.Position;
     OutHitResult.Normal = Normal;
+    OutHitResult.ShadingNormal = Normal;
+    OutHitResult.TexCoord = (1 - R1) * A.TexCoord + (R1 * (1 - R2)) * B.TexCoord + (R1 * R2) * C.TexCoord;
+    OutHitResult.TexCoordDensity = TexCoordDensity;
     OutHitResult.Emission = Material->Emission;
     OutHitResult.Object = this;
     OutHitResult.Material = Material;
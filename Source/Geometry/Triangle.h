@@ -13,25 +13,33 @@ public:
     virtual FBoundingBox GetBoundingBox() const override;
     virtual float GetArea() const override;
     virtual bool IsEmission() const override;
+    virtual bool GetLightBounds(FLightBounds& OutBounds) const override;
 
-    virtual void LineTrace(FHitResult& OutHitResult, const FRay& Ray) override;
-    virtual void Sample(FHitResult& OutHitResult, float& OutPdf) override;
+    virtual void LineTrace(FHitRecord& InOutRecord, const FRay& Ray) override;
+    virtual void GetSurfaceInteraction(const FHitRecord& Record, FHitResult& OutHitResult) override;
+    virtual void Sample(FHitResult& OutHitResult, float& OutPdf, const FVector2& U) override;
+
+    // Watertight intersection is the default. Moller-Trumbore is kept for comparison.
+    static void SetWatertightIntersection(bool bInWatertight) { bWatertight = bInWatertight; }
+
+private:
+    // Both return the distance along the ray and the barycentric weights of A, B and C at the hit.
+    bool IntersectWatertight(const FRay& Ray, float& OutTime, FVector& OutBarycentrics) const;
+    bool IntersectMollerTrumbore(const FRay& Ray, float& OutTime, FVector& OutBarycentrics) const;
 
 private:
-    union
-    {
-        struct
-        {
-            FVertex A;
-            FVertex B;
-            FVertex C;
-        };
-
-        FVertex Vertices[3];
-    };
+    static bool bWatertight;
+
+    FVertex A;
+    FVertex B;
+    FVertex C;
 
     FVector Normal;
     float Area = 0.0f;
+    // False if all vertex normals are equal: the geometric normal is used for shading then, exactly.
+    bool bSmoothShading = false;
+    // sqrt(texture coordinate area / area).
+    float TexCoordDensity = 0.0f;
 
     FMaterial* Material = nullptr;
 };
@@ -1,4 +1,59 @@
-#ifndef SOFT_RAY_TRACING
+#if !defined(SOFT_RAY_TRACING) && defined(SOFT_HEADLESS)
+#include "Render/Rasterization/RasterizationRenderer.h"
+#include "Render/Rasterization/TextureCacheTest.h"
+#include "Render/ImageWriter.h"
+#include "Geometry/ObjParser.h"
+#include "Material/Texture.h"
+
+#include <cstdio>
+
+// Rasterize a turntable of the model into numbered PNG files, without a window.
+int main()
+{
+    constexpr int32 Width = 800;
+    constexpr int32 Height = 600;
+
+    FViewport Viewport(Width, Height, 0.1f, 50.f);
+    FCamera Camera(FVector(0.f, 1.f, 10.f), 45.0f);
+    FRasterizationRenderer Renderer;
+    if (!Renderer.Initialize(Viewport, Camera, EShaderType::TextureNoLightShader))
+    {
+        return 1;
+    }
+
+    FMesh Mesh = FObjParser::Parse(AUTO_TEXT("../../Resources/Spot/Spot.obj"));
+    Renderer.LoadMesh(&Mesh);
+
+#ifdef SOFT_TEXTURE_CACHE_TEST
+    // Magnified and minified views, turned away from and across the texture's rows.
+    FTextureCacheTest::Run(&Renderer, &Mesh, AUTO_TEXT("../../Resources/Spot/spot_texture.png"),
+        {ETextureLayout::Linear, ETextureLayout::Tiled}, {ETextureSampleMode::Bilinear, ETextureSampleMode::Trilinear},
+        {{3.0f, FVector(0.0f, 40.0f, 0.0f)}, {3.0f, FVector(0.0f, 90.0f, 0.0f)}, {3.0f, FVector(60.0f, 40.0f, 0.0f)},
+            {3.0f, FVector(90.0f, 90.0f, 0.0f)}, {0.75f, FVector(90.0f, 40.0f, 0.0f)}, {0.25f, FVector(0.0f, 40.0f, 0.0f)}});
+    return 0;
+#else
+    FTexture Texture = FTexture(AUTO_TEXT("../../Resources/Spot/spot_texture.png"));
+    Mesh.SetTexture(&Texture);
+
+    constexpr int32 FrameNum = 36;
+
+    // Frames are written on the writer's thread while the next one is rasterized.
+    FAsyncImageWriter ImageWriter;
+    for (int32 Frame = 0; Frame < FrameNum; ++Frame)
+    {
+        Mesh.SetTransform(FVector::ZeroVector, FVector(0.0f, 360.0f * Frame / FrameNum, 0.0f), FVector(3.0f));
+        Renderer.Clear();
+        Renderer.Render();
+
+        char FilePath[64];
+        snprintf(FilePath, sizeof(FilePath), "./Frame_%04d.png", Frame);
+        ImageWriter.Write(FilePath, Renderer.GetRenderTarget(), Width, Height);
+    }
+
+    return ImageWriter.Flush() ? 0 : 1;
+#endif
+}
+#elif !defined(SOFT_RAY_TRACING)
 #include "Engine/Engine.h"
 
 int WINAPI WinMain(                   // WinMain
@@ -33,6 +88,7 @@ int WINAPI WinMain(                   // WinMain
 #else
 
 #include "Render/RayTracing/RayTracingRenderer.h"
+#include "Render/RayTracing/ConvergenceTest.h"
 #include "Geometry/ObjParser.h"
 #include "Material/Material.h"
 
@@ -42,8 +98,8 @@ int main()
     FMaterial M_Green = FMaterial(EMaterialType::MICROFACET, FVector(0.0f), FVector(0.14f, 0.45f, 0.091f), FVector(0.5f));
     FMaterial M_White = FMaterial(EMaterialType::MICROFACET, FVector(0.0f), FVector(0.725f, 0.71f, 0.68f), FVector(0.2f));
     FMaterial M_Floor = FMaterial(EMaterialType::MICROFACET, FVector(0.0f), FVector(0.15, 0.3f, 0.3f));
-    FMaterial M_Light = FMaterial(EMaterialType::MICROFACET, FVector(1.0f, 1.0f, 0.6f), FVector(0.65f, 0.65f, 0.65f));
-    FMaterial M_Light2 = FMaterial(EMaterialType::MICROFACET, FVector(0.7f, 0.7f, 1.0f), FVector(0.65f, 0.65f, 0.65f));
+    FMaterial M_Light = FMaterial(EMaterialType::MICROFACET, FVector(30.0f, 30.0f, 18.0f), FVector(0.65f, 0.65f, 0.65f));
+    FMaterial M_Light2 = FMaterial(EMaterialType::MICROFACET, FVector(21.0f, 21.0f, 30.0f), FVector(0.65f, 0.65f, 0.65f));
 
     FMesh Floor = FObjParser::Parse(AUTO_TEXT("../../Resources/Models/cornellbox/floor.obj"));
     Floor.SetMaterial(&M_Floor);
@@ -76,7 +132,15 @@ int main()
     RTRenderer->AddMesh(&Light2);
 
     RTRenderer->BuildBVH();
+#ifdef SOFT_RAY_TRACING_CONVERGENCE
+    FConvergenceTest::Run(RTRenderer, {ESamplerType::Independent, ESamplerType::Sobol, ESamplerType::BlueNoiseSobol}, {4, 16, 64, 128}, 2048);
+#else
+#ifdef SOFT_HEADLESS
+    RTRenderer->SetHeadless(true);
+    RTRenderer->SetOutputFile("./RTImage.exr");
+#endif
     RTRenderer->Render(128);
+#endif
 
     delete RTRenderer;
     RTRenderer = nullptr;
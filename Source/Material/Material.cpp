@@ -1,4 +1,5 @@
 #include "Material/Material.h"
+#include "Material/Texture.h"
 
 FMaterial::FMaterial()
     : MaterialType(EMaterialType::DIFFUSE), Emission(FVector::ZeroVector), Kd(FVector::ZeroVector), Ks(FVector::ZeroVector),
@@ -13,48 +14,120 @@ FMaterial::FMaterial(EMaterialType InMaterialType, const FVector& InEmission, co
 {
 }
 
+void FMaterial::BuildBasis(const FVector& N, FVector& OutE1, FVector& OutE2) const
+{
+    OutE2 = FMath::Abs(N.X) > FMath::Abs(N.Y) ? FVector(N.Z, 0.0f, -N.X) / FMath::Sqrt(N.X * N.X + N.Z * N.Z)
+                                              : FVector(0.0f, N.Z, -N.Y) / FMath::Sqrt(N.Y * N.Y + N.Z * N.Z);
+    OutE1 = FVector::CrossProduct(OutE2, N);
+}
+
 FVector FMaterial::LocalToWorld(const FVector& V, const FVector& N) const
 {
-    FVector E2 = FMath::Abs(N.X) > FMath::Abs(N.Y) ? FVector(N.Z, 0.0f, -N.X) / FMath::Sqrt(N.X * N.X + N.Z * N.Z)
-                                                   : FVector(0.0f, N.Z, -N.Y) / FMath::Sqrt(N.Y * N.Y + N.Z * N.Z);
-    FVector E1 = FVector::CrossProduct(E2, N);
+    FVector E1, E2;
+    BuildBasis(N, E1, E2);
     return E1 * V.X + E2 * V.Y + N * V.Z;
 }
 
+FVector FMaterial::WorldToLocal(const FVector& V, const FVector& N) const
+{
+    FVector E1, E2;
+    BuildBasis(N, E1, E2);
+    return FVector(V.Dot(E1), V.Dot(E2), V.Dot(N));
+}
+
+float FMaterial::GetSpecularProbability() const
+{
+    float SpecularWeight = FMath::Max(Ks.X, Ks.Y, Ks.Z);
+    float DiffuseWeight = FMath::Max(Kd.X, Kd.Y, Kd.Z);
+    if (SpecularWeight <= 0.0f)
+    {
+        return 0.0f;
+    }
+    return FMath::Clamp(SpecularWeight / (SpecularWeight + DiffuseWeight), 0.1f, 0.9f);
+}
+
 bool FMaterial::IsEmission() const
 {
     return !Emission.Equals(FVector::ZeroVector);
 }
 
-FVector FMaterial::Evaluate(const FVector& Wi, const FVector& Wo, const FVector& N) const
+bool FMaterial::IsLambertian() const
+{
+    return MaterialType == EMaterialType::DIFFUSE || GetSpecularProbability() <= 0.0f;
+}
+
+FVector FMaterial::GetAlbedo(const FVector2& TexCoord, float Footprint) const
+{
+    // A texture that failed to load has no levels.
+    if (AlbedoTexture == nullptr || AlbedoTexture->GetMipCount() == 0)
+    {
+        return Kd;
+    }
+
+    int32 Level = FTexureSampler::GetMipLevel(AlbedoTexture, Footprint);
+    FLinearColor Color = FTexureSampler::Sample(AlbedoTexture, TexCoord, Level, ETextureSampleMode::Bilinear);
+    return Kd * FVector(Color.R, Color.G, Color.B);
+}
+
+float FMaterial::GetSpreadAngle() const
+{
+    // Diffuse reflection spreads over the whole hemisphere, about one radian around the normal. A GGX lobe is about
+    // Roughness wide.
+    static constexpr float DiffuseSpreadAngle = 1.0f;
+    switch (MaterialType)
+    {
+    case EMaterialType::MICROFACET:
+    {
+        float SpecularProbability = GetSpecularProbability();
+        return SpecularProbability * Roughness + (1.0f - SpecularProbability) * DiffuseSpreadAngle;
+    }
+    default:
+        return DiffuseSpreadAngle;
+    }
+}
+
+FVector FMaterial::Evaluate(const FVector& Wi, const FVector& Wo, const FVector& N, const FVector& Albedo) const
 {
     switch (MaterialType)
     {
     case EMaterialType::DIFFUSE:
-        return N.Dot(Wo) > 0.0f ? Kd * PI_INV : FVector::ZeroVector;
+        return N.Dot(Wo) > 0.0f ? Albedo * PI_INV : FVector::ZeroVector;
     case EMaterialType::MICROFACET:
-        return N.Dot(Wo) > 0.0f ? FMaterialShader::CookTorranceBRDF(this, Wi, Wo, N) : FVector::ZeroVector;
+        return N.Dot(Wo) > 0.0f ? FMaterialShader::CookTorranceBRDF(this, Wi, Wo, N, Albedo) : FVector::ZeroVector;
     default:
         return FVector::ZeroVector;
     }
 }
 
-FVector FMaterial::Sample(const FVector& Wi, const FVector& N) const
+// Cosine-weighted direction on the local hemisphere. pdf = cos(theta) / PI.
+static FVector SampleCosineHemisphere(const FVector2& U)
+{
+    float Radius = FMath::Sqrt(U.X);
+    float Angle = 2.0f * PI * U.Y;
+    return FVector(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), FMath::Sqrt(FMath::Max(0.0f, 1.0f - U.X)));
+}
+
+FVector FMaterial::Sample(const FVector& Wo, const FVector& N, const FVector2& U) const
 {
     switch (MaterialType)
     {
     case EMaterialType::DIFFUSE:
+        return LocalToWorld(SampleCosineHemisphere(U), N);
     case EMaterialType::MICROFACET:
     {
-        // Uniform sample on the hemisphere.
-        float R1 = FMath::RandomFloat(), R2 = FMath::RandomFloat();
-        float Z = FMath::Abs(1.0f - 2.0f * R1);
-
-        float Radius = FMath::Sqrt(1.0f - Z * Z);
-        float Angle = 2.0f * PI * R2;
-
-        FVector LocalRay = FVector(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), Z);
-        return LocalToWorld(LocalRay, N);
+        // Pick a lobe with U.X, then reuse the rest of U.X for the lobe itself.
+        float SpecularProbability = GetSpecularProbability();
+        if (U.X < SpecularProbability)
+        {
+            FVector LocalWo = WorldToLocal(Wo, N);
+            FVector2 USpecular = FVector2(FMath::Min(U.X / SpecularProbability, ONE_MINUS_EPSILON), U.Y);
+            FVector LocalH = FMaterialShader::SampleGGXVisibleNormal(LocalWo, Roughness, USpecular);
+            FVector LocalWi = LocalH * (2.0f * LocalWo.Dot(LocalH)) - LocalWo;
+            return LocalToWorld(LocalWi, N);
+        }
+
+        FVector2 UDiffuse = FVector2(FMath::Min((U.X - SpecularProbability) / (1.0f - SpecularProbability), ONE_MINUS_EPSILON), U.Y);
+        return LocalToWorld(SampleCosineHemisphere(UDiffuse), N);
     }
     default:
         return FVector::ZeroVector;
@@ -63,35 +136,57 @@ FVector FMaterial::Sample(const FVector& Wi, const FVector& N) const
 
 float FMaterial::PDF(const FVector& Wi, const FVector& Wo, const FVector& N) const
 {
+    float NDotWi = N.Dot(Wi);
+    float NDotWo = N.Dot(Wo);
+    if (NDotWi <= 0.0f || NDotWo <= 0.0f)
+    {
+        return 0.0f;
+    }
+
     switch (MaterialType)
     {
     case EMaterialType::DIFFUSE:
+        return NDotWi * PI_INV;
     case EMaterialType::MICROFACET:
-        // Uniform sample. pdf = The reciprocal of the area of the hemisphere.
-        return N.Dot(Wo) > 0.0f ? 0.5f * PI_INV : 0.0f;
+    {
+        float DiffusePDF = NDotWi * PI_INV;
+
+        float SpecularProbability = GetSpecularProbability();
+        if (SpecularProbability <= 0.0f)
+        {
+            return DiffusePDF;
+        }
+
+        // Visible normal pdf D_V(H) = G1(Wo) * max(0, Wo.H) * D(H) / (N.Wo), and the reflection Jacobian is 1 / (4 * Wo.H).
+        FVector H = (Wi + Wo).GetSafeNormal();
+        float D = FMaterialShader::D_TrowbridgeReitzGGX(FMath::Max(N.Dot(H), 0.0f), Roughness);
+        float G1 = FMaterialShader::G1_SmithGGX(WorldToLocal(Wo, N), Roughness);
+        float SpecularPDF = G1 * D / (4.0f * NDotWo);
+
+        return SpecularProbability * SpecularPDF + (1.0f - SpecularProbability) * DiffusePDF;
+    }
     default:
         return 0.0f;
     }
 }
 
-FVector FMaterialShader::CookTorranceBRDF(const FMaterial* Material, const FVector& Wi, const FVector& Wo, const FVector& N)
+FVector FMaterialShader::CookTorranceBRDF(const FMaterial* Material, const FVector& Wi, const FVector& Wo, const FVector& N, const FVector& Albedo)
 {
-    FVector V = -Wi, L = Wo;
+    FVector V = Wo, L = Wi;
     FVector H = (V + L).GetSafeNormal();
 
     float NDotH = FMath::Max(N.Dot(H), KINDA_SMALL_NUMBER);
     float NDotL = FMath::Max(N.Dot(L), KINDA_SMALL_NUMBER);
     float NDotV = FMath::Max(N.Dot(V), KINDA_SMALL_NUMBER);
-    float VDotH = FMath::Max(L.Dot(H), KINDA_SMALL_NUMBER);
+    float VDotH = FMath::Max(V.Dot(H), KINDA_SMALL_NUMBER);
 
     float D = D_TrowbridgeReitzGGX(NDotH, Material->Roughness);
     float G = G_SchlickSmithGGX(NDotV, NDotL, Material->Roughness);
     float F = F_Schlick(VDotH, 0.5f);
 
-    float Diffuse = NDotV + 0.5f;
     float Specular = D * G * F / (4.0f * NDotV * NDotL);
 
-    return Diffuse * Material->Kd * PI_INV + Specular * Material->Ks;
+    return Albedo * PI_INV + Specular * Material->Ks;
 }
 
 float FMaterialShader::D_TrowbridgeReitzGGX(float NDotH, float Alpha)
@@ -102,6 +197,40 @@ float FMaterialShader::D_TrowbridgeReitzGGX(float NDotH, float Alpha)
     return Alpha2 * PI_INV / (D * D);
 }
 
+float FMaterialShader::G1_SmithGGX(const FVector& LocalV, float Alpha)
+{
+    float CosTheta2 = LocalV.Z * LocalV.Z;
+    if (CosTheta2 <= 0.0f)
+    {
+        return 0.0f;
+    }
+    float Tan2Theta = FMath::Max(0.0f, 1.0f - CosTheta2) / CosTheta2;
+    return 2.0f / (1.0f + FMath::Sqrt(1.0f + Alpha * Alpha * Tan2Theta));
+}
+
+FVector FMaterialShader::SampleGGXVisibleNormal(const FVector& LocalV, float Alpha, const FVector2& U)
+{
+    // Stretch the view direction to the hemisphere configuration.
+    FVector Vh = FVector(Alpha * LocalV.X, Alpha * LocalV.Y, LocalV.Z).GetSafeNormal();
+
+    // Orthonormal basis around Vh.
+    float LengthSquared = Vh.X * Vh.X + Vh.Y * Vh.Y;
+    FVector T1 = LengthSquared > 0.0f ? FVector(-Vh.Y, Vh.X, 0.0f) * FMath::InvSqrt(LengthSquared) : FVector(1.0f, 0.0f, 0.0f);
+    FVector T2 = FVector::CrossProduct(Vh, T1);
+
+    // Uniform point on the projected half disk.
+    float Radius = FMath::Sqrt(U.X);
+    float Phi = 2.0f * PI * U.Y;
+    float P1 = Radius * FMath::Cos(Phi);
+    float P2 = Radius * FMath::Sin(Phi);
+    float S = 0.5f * (1.0f + Vh.Z);
+    P2 = (1.0f - S) * FMath::Sqrt(FMath::Max(0.0f, 1.0f - P1 * P1)) + S * P2;
+
+    // Reproject onto the hemisphere and unstretch.
+    FVector Nh = T1 * P1 + T2 * P2 + Vh * FMath::Sqrt(FMath::Max(0.0f, 1.0f - P1 * P1 - P2 * P2));
+    return FVector(Alpha * Nh.X, Alpha * Nh.Y, FMath::Max(0.0f, Nh.Z)).GetSafeNormal();
+}
+
 float FMaterialShader::G_SchlickSmithGGX(float NDotV, float NDotL, float Roughness)
 {
     float K = (Roughness + 1.0f) * (Roughness + 1.0f) * 0.125f;
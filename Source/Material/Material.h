@@ -9,6 +9,7 @@ enum class EMaterialType
 };
 
 class FMaterialShader;
+struct FTexture;
 
 struct FMaterial
 {
@@ -23,33 +24,59 @@ struct FMaterial
     float SpecularExponent;
     float IndexOfRefraction;
 
+    // Optional sRGB texture multiplied into Kd.
+    const FTexture* AlbedoTexture = nullptr;
+
 public:
     FMaterial();
     FMaterial(EMaterialType InMaterialType, const FVector& InEmission = FVector(0.0f), const FVector& InKd = FVector(0.0f),
         const FVector& InKs = FVector(0.0f), float InSpecularExponent = 0.0f, float InIndexOfRefraction = 0.0f);
 
     bool IsEmission() const;
+    // No specular lobe: the BRDF is Albedo / PI.
+    bool IsLambertian() const;
+
+    // Diffuse reflectance at TexCoord: Kd, times the texture if there is one. Footprint is the width of the surface area
+    // the lookup stands for, in texture coordinates, and picks the mip level.
+    FVector GetAlbedo(const FVector2& TexCoord, float Footprint) const;
+
+    // How much a bounce off this material widens a ray cone, in radians.
+    float GetSpreadAngle() const;
 
-    // BRDF.
-    FVector Evaluate(const FVector& Wi, const FVector& Wo, const FVector& N) const;
+    // BRDF with the diffuse reflectance Albedo, usually from GetAlbedo. Wi points towards the light, Wo towards the viewer,
+    // both away from the surface.
+    FVector Evaluate(const FVector& Wi, const FVector& Wo, const FVector& N, const FVector& Albedo) const;
 
-    // Sample the direction of the outgoing ray.
-    FVector Sample(const FVector& Wi, const FVector& N) const;
+    // Sample the incident direction Wi for the view direction Wo from two uniform random numbers.
+    // Diffuse: cosine-weighted. Microfacet: the diffuse lobe or the GGX visible normals, picked by their weights.
+    FVector Sample(const FVector& Wo, const FVector& N, const FVector2& U) const;
 
-    // The pdf of the sampling method.
+    // The solid angle pdf of Sample.
     float PDF(const FVector& Wi, const FVector& Wo, const FVector& N) const;
 
 private:
+    // Probability that Sample picks the specular lobe of a microfacet material.
+    float GetSpecularProbability() const;
+
+    void BuildBasis(const FVector& N, FVector& OutE1, FVector& OutE2) const;
     FVector LocalToWorld(const FVector& V, const FVector& N) const;
+    FVector WorldToLocal(const FVector& V, const FVector& N) const;
 };
 
 class FMaterialShader
 {
 public:
-    static FVector CookTorranceBRDF(const FMaterial* Material, const FVector& Wi, const FVector& Wo, const FVector& N);
+    static FVector CookTorranceBRDF(const FMaterial* Material, const FVector& Wi, const FVector& Wo, const FVector& N, const FVector& Albedo);
 
-private:
     static float D_TrowbridgeReitzGGX(float NDotH, float Alpha);
+
+    // Smith masking of GGX for one direction, in the local frame of the normal.
+    static float G1_SmithGGX(const FVector& LocalV, float Alpha);
+
+    // Sample a visible normal of GGX for the local view direction (Heitz 2018, "Sampling the GGX Distribution of Visible Normals").
+    static FVector SampleGGXVisibleNormal(const FVector& LocalV, float Alpha, const FVector2& U);
+
+private:
     static float G_SchlickSmithGGX(float NDotV, float NDotL, float Alpha);
     static float F_Schlick(float VDotH, float F0);
 };
@@ -1,6 +1,16 @@
 #include "Material/Texture.h"
 
-FTexture::FTexture(const FString& Path)
+#ifdef SOFT_TEXTURE_CACHE_TEST
+#include "Material/TextureCacheSimulator.h"
+#endif
+
+// Z-order index of texel (U, V) inside its 4x4 block: the bits of U and V interleaved, U lowest.
+static FORCEINLINE int32 GetBlockTexelIndex(int32 U, int32 V)
+{
+    return (U & 1) | ((V & 1) << 1) | ((U & 2) << 1) | ((V & 2) << 2);
+}
+
+FTexture::FTexture(const FString& Path, ETextureLayout InLayout) : Layout(InLayout)
 {
     cv::Mat Image = cv::imread(FStringUtils::ToAString(Path));
     if (!Image.empty())
@@ -20,11 +30,28 @@ FTexture::FTexture(const FString& Path)
 
         Data = new uint8[Width * Height * 3];
         memcpy(Data, Image.data, Width * Height * 3 * sizeof(uint8));
+
+        BuildMips();
+        if (Layout == ETextureLayout::Tiled)
+        {
+            TileMips();
+        }
     }
 }
 
 FTexture::~FTexture()
 {
+    // Level 0 is Data itself.
+    for (int32 Level = 0; Level < GetMipCount(); ++Level)
+    {
+        if (Level > 0)
+        {
+            delete[] Mips[Level].Data;
+        }
+        delete[] Mips[Level].Blocks;
+    }
+    Mips.clear();
+
     if (Data != nullptr)
     {
         delete[] Data;
@@ -32,42 +59,137 @@ FTexture::~FTexture()
     }
 }
 
+void FTexture::BuildMips()
+{
+    Mips.emplace_back(FTextureMip{Width, Height, Data});
+    while (Mips.back().Width > 1 || Mips.back().Height > 1)
+    {
+        const FTextureMip& Source = Mips.back();
+        FTextureMip Mip;
+        Mip.Width = FMath::Max(Source.Width / 2, 1);
+        Mip.Height = FMath::Max(Source.Height / 2, 1);
+        Mip.Data = new uint8[Mip.Width * Mip.Height * 3];
+
+        for (int32 V = 0; V < Mip.Height; ++V)
+        {
+            for (int32 U = 0; U < Mip.Width; ++U)
+            {
+                // The 2x2 texels below, fewer where the source is only one texel wide or high.
+                int32 U0 = FMath::Min(2 * U, Source.Width - 1), U1 = FMath::Min(2 * U + 1, Source.Width - 1);
+                int32 V0 = FMath::Min(2 * V, Source.Height - 1), V1 = FMath::Min(2 * V + 1, Source.Height - 1);
+                const uint8* Texels[4] = {Source.Data + (V0 * Source.Width + U0) * 3, Source.Data + (V0 * Source.Width + U1) * 3,
+                    Source.Data + (V1 * Source.Width + U0) * 3, Source.Data + (V1 * Source.Width + U1) * 3};
+
+                FLinearColor Average(0.0f, 0.0f, 0.0f);
+                for (const uint8* Texel : Texels)
+                {
+                    Average += FLinearColor(FColor(Texel[0], Texel[1], Texel[2]));
+                }
+                FColor Color = (Average * 0.25f).ToFColorSRGB();
+
+                // ToFColorSRGB packs the channels in BGRA order, the layout of the rasterizer's render target.
+                uint8* Out = Mip.Data + (V * Mip.Width + U) * 3;
+                Out[0] = Color.B;
+                Out[1] = Color.G;
+                Out[2] = Color.R;
+            }
+        }
+        Mips.emplace_back(Mip);
+    }
+}
+
+void FTexture::TileMips()
+{
+    for (FTextureMip& Mip : Mips)
+    {
+        Mip.BlocksPerRow = (Mip.Width + 3) / 4;
+        int32 BlockRows = (Mip.Height + 3) / 4;
+        Mip.Blocks = new FTexelBlock[Mip.BlocksPerRow * BlockRows];
+
+        for (int32 V = 0; V < BlockRows * 4; ++V)
+        {
+            for (int32 U = 0; U < Mip.BlocksPerRow * 4; ++U)
+            {
+                // Padding repeats the edge texels.
+                const uint8* Texel = Mip.Data + (FMath::Min(V, Mip.Height - 1) * Mip.Width + FMath::Min(U, Mip.Width - 1)) * 3;
+                FTexelBlock& Block = Mip.Blocks[(V >> 2) * Mip.BlocksPerRow + (U >> 2)];
+                Block.Texels[GetBlockTexelIndex(U, V)] = FColor(Texel[0], Texel[1], Texel[2]).Bits;
+            }
+        }
+
+        delete[] Mip.Data;
+        Mip.Data = nullptr;
+    }
+    Data = nullptr;
+}
+
 FColor FTexture::ReadPixel(int32 U, int32 V) const
 {
-    int32 PixelIndex = (V * Width + U) * 3;
-    return FColor(Data[PixelIndex], Data[PixelIndex + 1], Data[PixelIndex + 2]);
+    return ReadPixel(U, V, 0);
+}
+
+FColor FTexture::ReadPixel(int32 U, int32 V, int32 Level) const
+{
+    const FTextureMip& Mip = Mips[Level];
+    if (Layout == ETextureLayout::Tiled)
+    {
+        const FTexelBlock& Block = Mip.Blocks[(V >> 2) * Mip.BlocksPerRow + (U >> 2)];
+#ifdef SOFT_TEXTURE_CACHE_TEST
+        FTextureCacheSimulator::Touch(&Block.Texels[GetBlockTexelIndex(U, V)]);
+#endif
+        return FColor(Block.Texels[GetBlockTexelIndex(U, V)]);
+    }
+
+    int32 PixelIndex = (V * Mip.Width + U) * 3;
+#ifdef SOFT_TEXTURE_CACHE_TEST
+    // A texel can straddle two lines.
+    FTextureCacheSimulator::Touch(Mip.Data + PixelIndex);
+    FTextureCacheSimulator::Touch(Mip.Data + PixelIndex + 2);
+#endif
+    return FColor(Mip.Data[PixelIndex], Mip.Data[PixelIndex + 1], Mip.Data[PixelIndex + 2]);
 }
 
 FLinearColor FTexureSampler::Sample(const FTexture* Texture, const FVector2& UV, ETextureSampleMode TextureSampleMode)
 {
+#ifdef SOFT_TEXTURE_CACHE_TEST
+    FTextureCacheSimulator::AddSample();
+#endif
+    return Sample(Texture, UV, 0, TextureSampleMode);
+}
+
+FLinearColor FTexureSampler::Sample(const FTexture* Texture, const FVector2& UV, int32 Level, ETextureSampleMode TextureSampleMode)
+{
+    const FTextureMip& Mip = Texture->Mips[Level];
+
     switch (TextureSampleMode)
     {
     case ETextureSampleMode::Nearest:
     {
-        int32 IntU = (int32)(FMath::Clamp(UV.X, 0.f, 1.f) * (Texture->Width - 1) + 0.5f);
-        int32 IntV = (int32)(FMath::Clamp(UV.Y, 0.f, 1.f) * (Texture->Height - 1) + 0.5f);
+        int32 IntU = (int32)(FMath::Clamp(UV.X, 0.f, 1.f) * (Mip.Width - 1) + 0.5f);
+        int32 IntV = (int32)(FMath::Clamp(UV.Y, 0.f, 1.f) * (Mip.Height - 1) + 0.5f);
 
-        return FLinearColor(Texture->ReadPixel(IntU, IntV));
+        return FLinearColor(Texture->ReadPixel(IntU, IntV, Level));
     }
     case ETextureSampleMode::Bilinear:
     {
-        float U = FMath::Clamp(UV.X, 0.f, 1.f) * Texture->Width;
-        float V = FMath::Clamp(UV.Y, 0.f, 1.f) * Texture->Height;
+        // Texel centers sit at half-integer coordinates.
+        float U = FMath::Clamp(FMath::Clamp(UV.X, 0.f, 1.f) * Mip.Width - 0.5f, 0.f, (float)(Mip.Width - 1));
+        float V = FMath::Clamp(FMath::Clamp(UV.Y, 0.f, 1.f) * Mip.Height - 0.5f, 0.f, (float)(Mip.Height - 1));
 
-        int32 FloorU = (int32)FMath::Floor(U), CeilU = FMath::Min((int32)FMath::Ceil(U), Texture->Width - 1);
-        int32 FloorV = (int32)FMath::Floor(V), CeilV = FMath::Min((int32)FMath::Ceil(V), Texture->Height - 1);
+        int32 FloorU = (int32)FMath::Floor(U), CeilU = FMath::Min(FloorU + 1, Mip.Width - 1);
+        int32 FloorV = (int32)FMath::Floor(V), CeilV = FMath::Min(FloorV + 1, Mip.Height - 1);
 
-        FLinearColor LD = FLinearColor(Texture->ReadPixel(FloorU, FloorV));
-        FLinearColor LU = FLinearColor(Texture->ReadPixel(FloorU, CeilV));
-        FLinearColor RD = FLinearColor(Texture->ReadPixel(CeilU, FloorV));
-        FLinearColor RU = FLinearColor(Texture->ReadPixel(CeilU, CeilV));
+        FLinearColor LD = FLinearColor(Texture->ReadPixel(FloorU, FloorV, Level));
+        FLinearColor LU = FLinearColor(Texture->ReadPixel(FloorU, CeilV, Level));
+        FLinearColor RD = FLinearColor(Texture->ReadPixel(CeilU, FloorV, Level));
+        FLinearColor RU = FLinearColor(Texture->ReadPixel(CeilU, CeilV, Level));
 
         float LerpU = (U - FloorU);
         float LerpV = (V - FloorV);
 
-        FLinearColor InterpolatedD = LerpU * LD + (1 - LerpU) * RD;
-        FLinearColor InterpolatedU = LerpU * LU + (1 - LerpU) * RU;
-        FLinearColor InterpolatedColor = LerpV * InterpolatedD + (1 - LerpV) * InterpolatedU;
+        FLinearColor InterpolatedD = (1 - LerpU) * LD + LerpU * RD;
+        FLinearColor InterpolatedU = (1 - LerpU) * LU + LerpU * RU;
+        FLinearColor InterpolatedColor = (1 - LerpV) * InterpolatedD + LerpV * InterpolatedU;
 
         return InterpolatedColor;
     }
@@ -75,3 +197,52 @@ FLinearColor FTexureSampler::Sample(const FTexture* Texture, const FVector2& UV,
         return FLinearColor(0.f, 0.f, 0.f);
     }
 }
+
+FLinearColor FTexureSampler::Sample(const FTexture* Texture, const FVector2& UV, const FVector2& UVDX, const FVector2& UVDY,
+    ETextureSampleMode TextureSampleMode)
+{
+#ifdef SOFT_TEXTURE_CACHE_TEST
+    FTextureCacheSimulator::AddSample();
+#endif
+    float Lod = GetMipLod(Texture, UVDX, UVDY);
+    if (TextureSampleMode != ETextureSampleMode::Trilinear)
+    {
+        return Sample(Texture, UV, (int32)(Lod + 0.5f), TextureSampleMode);
+    }
+
+    // A magnified or exactly fitting footprint needs one level only.
+    int32 Level = (int32)Lod;
+    float LerpLevel = Lod - Level;
+    FLinearColor Color = Sample(Texture, UV, Level, ETextureSampleMode::Bilinear);
+    if (LerpLevel <= 0.0f)
+    {
+        return Color;
+    }
+    FLinearColor NextColor = Sample(Texture, UV, Level + 1, ETextureSampleMode::Bilinear);
+    return (1 - LerpLevel) * Color + LerpLevel * NextColor;
+}
+
+int32 FTexureSampler::GetMipLevel(const FTexture* Texture, float Footprint)
+{
+    // log2 of the footprint in level-0 texels, rounded to the nearest level.
+    float TexelFootprint = Footprint * FMath::Sqrt((float)Texture->Width * Texture->Height);
+    if (!(TexelFootprint > 1.0f))
+    {
+        return 0;
+    }
+    int32 Level = (int32)FMath::Floor(FMath::Log2(TexelFootprint) + 0.5f);
+    return FMath::Min(Level, Texture->GetMipCount() - 1);
+}
+
+float FTexureSampler::GetMipLod(const FTexture* Texture, const FVector2& UVDX, const FVector2& UVDY)
+{
+    FVector2 TexelDX = FVector2(UVDX.X * Texture->Width, UVDX.Y * Texture->Height);
+    FVector2 TexelDY = FVector2(UVDY.X * Texture->Width, UVDY.Y * Texture->Height);
+    float SquaredFootprint = FMath::Max(TexelDX.X * TexelDX.X + TexelDX.Y * TexelDX.Y, TexelDY.X * TexelDY.X + TexelDY.Y * TexelDY.Y);
+    if (!(SquaredFootprint > 1.0f))
+    {
+        return 0.0f;
+    }
+    // log2 of the length is half the log2 of its square.
+    return FMath::Min(0.5f * FMath::Log2(SquaredFootprint), (float)(Texture->GetMipCount() - 1));
+}
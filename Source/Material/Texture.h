@@ -7,24 +7,70 @@
 #include "Texture.h"
 #pragma warning(default : 4819)
 
+enum class ETextureLayout
+{
+    // RGB8 rows, as loaded.
+    Linear,
+    // RGBA8 in 4x4 texel blocks of one cache line each, texels in Z-order inside a block. The 2x2 texels of a bilinear
+    // fetch mostly share a line, and walking along V reads a new line every four texels instead of every texel.
+    Tiled
+};
+
+// A 4x4 block of RGBA8 texels, aligned to a cache line.
+struct alignas(64) FTexelBlock
+{
+    uint32 Texels[16];
+};
+
+// One level of the mip chain, stored in Data or Blocks depending on the texture's layout.
+struct FTextureMip
+{
+    int32 Width = 0;
+    int32 Height = 0;
+    uint8* Data = nullptr;
+
+    // Tiled only. Blocks run in rows of BlocksPerRow, with the last row and column padded out to whole blocks.
+    FTexelBlock* Blocks = nullptr;
+    int32 BlocksPerRow = 0;
+};
+
 struct FTexture
 {
     int32 Width = 0;
     int32 Height = 0;
 
+    // Level 0 in the linear layout. Null in the tiled layout, read the texels with ReadPixel instead.
     uint8* Data = nullptr;
 
+    // Level 0 is the image itself. Every next level halves the size, down to 1x1.
+    TArray<FTextureMip> Mips;
+
 public:
-    FTexture(const FString& Path);
+    FTexture(const FString& Path, ETextureLayout InLayout = ETextureLayout::Tiled);
     ~FTexture();
 
     FColor ReadPixel(int32 U, int32 V) const;
+    FColor ReadPixel(int32 U, int32 V, int32 Level) const;
+
+    int32 GetMipCount() const { return (int32)Mips.size(); }
+    ETextureLayout GetLayout() const { return Layout; }
+
+private:
+    // Box-filter each level from the previous one, averaging in linear space so that minified textures keep their brightness.
+    void BuildMips();
+    // Move every level from Data into Blocks.
+    void TileMips();
+
+private:
+    ETextureLayout Layout;
 };
 
 enum class ETextureSampleMode
 {
     Nearest,
-    Bilinear
+    Bilinear,
+    // Bilinear in the two levels around a fractional level of detail, blended between them.
+    Trilinear
 };
 
 class FTexureSampler
@@ -32,4 +78,15 @@ class FTexureSampler
 public:
     static FLinearColor Sample(
         const FTexture* Texture, const FVector2& UV, ETextureSampleMode TextureSampleMode = ETextureSampleMode::Nearest);
+    static FLinearColor Sample(const FTexture* Texture, const FVector2& UV, int32 Level, ETextureSampleMode TextureSampleMode);
+    // Filter over the screen footprint given by the texture coordinate derivatives along the screen axes: Nearest and
+    // Bilinear read the closest level, Trilinear blends the two around the level of detail.
+    static FLinearColor Sample(const FTexture* Texture, const FVector2& UV, const FVector2& UVDX, const FVector2& UVDY,
+        ETextureSampleMode TextureSampleMode);
+
+    // The mip level whose texels are about Footprint wide, for a footprint given in texture coordinates.
+    static int32 GetMipLevel(const FTexture* Texture, float Footprint);
+    // Fractional level of detail for the derivatives, from 0 to the last level: log2 of the longer axis of the footprint
+    // in level-0 texels.
+    static float GetMipLod(const FTexture* Texture, const FVector2& UVDX, const FVector2& UVDY);
 };
@@ -0,0 +1,52 @@
+#include "Material/TextureCacheSimulator.h"
+
+#include <cstring>
+
+uintptr_t FTextureCacheSimulator::Tags[SetNum][WayNum];
+uint64 FTextureCacheSimulator::LastUse[SetNum][WayNum];
+uint64 FTextureCacheSimulator::Clock = 0;
+
+int64 FTextureCacheSimulator::SampleNum = 0;
+int64 FTextureCacheSimulator::ReadNum = 0;
+int64 FTextureCacheSimulator::MissNum = 0;
+::std::unordered_set<uintptr_t> FTextureCacheSimulator::Lines;
+
+void FTextureCacheSimulator::Reset()
+{
+    memset(Tags, 0, sizeof(Tags));
+    memset(LastUse, 0, sizeof(LastUse));
+    Clock = 0;
+
+    SampleNum = 0;
+    ReadNum = 0;
+    MissNum = 0;
+    Lines.clear();
+}
+
+void FTextureCacheSimulator::Touch(const void* Address)
+{
+    uintptr_t Line = (uintptr_t)Address >> LineBits;
+    int32 Set = (int32)(Line % SetNum);
+    ++ReadNum;
+    ++Clock;
+    Lines.insert(Line);
+
+    // Hit, or else replace the least recently used way.
+    int32 Oldest = 0;
+    for (int32 Way = 0; Way < WayNum; ++Way)
+    {
+        if (LastUse[Set][Way] != 0 && Tags[Set][Way] == Line)
+        {
+            LastUse[Set][Way] = Clock;
+            return;
+        }
+        if (LastUse[Set][Way] < LastUse[Set][Oldest])
+        {
+            Oldest = Way;
+        }
+    }
+
+    ++MissNum;
+    Tags[Set][Oldest] = Line;
+    LastUse[Set][Oldest] = Clock;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <unordered_set>
+
+// Model of a 32 KB, 8-way set associative L1 data cache with 64-byte lines and LRU replacement, fed with the address of
+// every texel read. SOFT_TEXTURE_CACHE_TEST builds report the reads from FTexture; elsewhere nothing calls it.
+class FTextureCacheSimulator
+{
+public:
+    // Empty the cache and zero the counters.
+    static void Reset();
+
+    static void Touch(const void* Address);
+    static void AddSample() { ++SampleNum; }
+
+    static int64 GetSampleNum() { return SampleNum; }
+    static int64 GetReadNum() { return ReadNum; }
+    static int64 GetMissNum() { return MissNum; }
+    // Distinct lines read since Reset, the working set independent of the cache's size.
+    static int64 GetLineNum() { return (int64)Lines.size(); }
+
+private:
+    static constexpr int32 LineBits = 6;
+    static constexpr int32 SetNum = 64;
+    static constexpr int32 WayNum = 8;
+
+    // Line address and time of last use of every way. Unused ways have time 0.
+    static uintptr_t Tags[SetNum][WayNum];
+    static uint64 LastUse[SetNum][WayNum];
+    static uint64 Clock;
+
+    static int64 SampleNum;
+    static int64 ReadNum;
+    static int64 MissNum;
+    static ::std::unordered_set<uintptr_t> Lines;
+};
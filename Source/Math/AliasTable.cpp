@@ -0,0 +1,82 @@
+#include "Math/AliasTable.h"
+
+FAliasTable::FAliasTable(const TArray<float>& Weights)
+{
+    int32 Num = (int32)Weights.size();
+    Bins.resize(Num);
+
+    double WeightSum = 0.0;
+    for (float Weight : Weights)
+    {
+        WeightSum += Weight;
+    }
+    if (WeightSum <= 0.0)
+    {
+        Bins.clear();
+        return;
+    }
+
+    // Scale the probabilities so that the average bin holds exactly 1, and split bins into under- and overfull ones.
+    TArray<int32> Under, Over;
+    TArray<double> Scaled(Num);
+    for (int32 i = 0; i < Num; ++i)
+    {
+        Bins[i].PMF = (float)(Weights[i] / WeightSum);
+        Scaled[i] = Weights[i] / WeightSum * Num;
+        (Scaled[i] < 1.0 ? Under : Over).emplace_back(i);
+    }
+
+    // Fill every underfull bin with the excess of an overfull one.
+    while (!Under.empty() && !Over.empty())
+    {
+        int32 Small = Under.back(), Large = Over.back();
+        Under.pop_back();
+        Over.pop_back();
+
+        Bins[Small].Probability = (float)Scaled[Small];
+        Bins[Small].Alias = Large;
+
+        Scaled[Large] -= 1.0 - Scaled[Small];
+        (Scaled[Large] < 1.0 ? Under : Over).emplace_back(Large);
+    }
+
+    // Whatever is left is full up to rounding error.
+    for (int32 Index : Under)
+    {
+        Bins[Index].Probability = 1.0f;
+    }
+    for (int32 Index : Over)
+    {
+        Bins[Index].Probability = 1.0f;
+    }
+}
+
+int32 FAliasTable::Sample(float U, float* OutPMF, float* OutRemappedU) const
+{
+    int32 Num = (int32)Bins.size();
+    int32 Offset = FMath::Min((int32)(U * Num), Num - 1);
+    float Up = FMath::Min(U * Num - Offset, ONE_MINUS_EPSILON);
+
+    int32 Index = Offset;
+    if (Up < Bins[Offset].Probability)
+    {
+        if (OutRemappedU != nullptr)
+        {
+            *OutRemappedU = FMath::Min(Up / Bins[Offset].Probability, ONE_MINUS_EPSILON);
+        }
+    }
+    else
+    {
+        Index = Bins[Offset].Alias;
+        if (OutRemappedU != nullptr)
+        {
+            *OutRemappedU = FMath::Min((Up - Bins[Offset].Probability) / (1.0f - Bins[Offset].Probability), ONE_MINUS_EPSILON);
+        }
+    }
+
+    if (OutPMF != nullptr)
+    {
+        *OutPMF = Bins[Index].PMF;
+    }
+    return Index;
+}
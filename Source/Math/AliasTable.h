@@ -0,0 +1,29 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+// Walker's alias method (Vose's construction). Picks an index proportionally to its weight in O(1).
+class FAliasTable
+{
+public:
+    FAliasTable() = default;
+    explicit FAliasTable(const TArray<float>& Weights);
+
+    // Pick an index from a uniform number in [0, 1).
+    // OutRemappedU receives the unused part of U, rescaled to a fresh uniform number in [0, 1).
+    int32 Sample(float U, float* OutPMF = nullptr, float* OutRemappedU = nullptr) const;
+
+    float PMF(int32 Index) const { return Bins[Index].PMF; }
+    int32 Size() const { return (int32)Bins.size(); }
+    bool IsEmpty() const { return Bins.empty(); }
+
+private:
+    struct FBin
+    {
+        float Probability = 0.0f; // Probability of keeping this bin rather than jumping to its alias.
+        int32 Alias = -1;
+        float PMF = 0.0f;
+    };
+
+    TArray<FBin> Bins;
+};
@@ -51,7 +51,7 @@ public:
     constexpr FORCEINLINE FLinearColor(float InR, float InG, float InB, float InA = 1.0f) : R(InR), G(InG), B(InB), A(InA) {}
 
     // sRGB space -> Linear space.
-    constexpr FORCEINLINE FLinearColor(const FColor& Color);
+    FORCEINLINE FLinearColor(const FColor& Color);
 
     FORCEINLINE FLinearColor operator+(const FLinearColor& ColorB) const
     {
@@ -142,7 +142,7 @@ public:
     FColor ToFColorSRGB() const;
 };
 
-constexpr FORCEINLINE FLinearColor::FLinearColor(const FColor& Color)
+FORCEINLINE FLinearColor::FLinearColor(const FColor& Color)
     : R(sRGBToLinearTable[Color.R]), //
       G(sRGBToLinearTable[Color.G]), //
       B(sRGBToLinearTable[Color.B]), //
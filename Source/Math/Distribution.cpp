@@ -0,0 +1,84 @@
+#include "Math/Distribution.h"
+
+#include <algorithm>
+
+FDistribution1D::FDistribution1D(const float* Weights, int32 Num) : Function(Weights, Weights + Num)
+{
+    CDF.resize((::std::size_t)Num + 1);
+    CDF[0] = 0.0f;
+    for (int32 i = 0; i < Num; ++i)
+    {
+        CDF[i + 1] = CDF[i] + FMath::Abs(Function[i]) / Num;
+    }
+
+    Integral = CDF[Num];
+    if (Integral <= 0.0f)
+    {
+        // Nothing to importance sample: fall back to a uniform density.
+        for (int32 i = 1; i <= Num; ++i)
+        {
+            CDF[i] = (float)i / Num;
+        }
+        return;
+    }
+    for (int32 i = 1; i <= Num; ++i)
+    {
+        CDF[i] /= Integral;
+    }
+}
+
+float FDistribution1D::SampleContinuous(float U, float* OutPDF, int32* OutOffset) const
+{
+    // The last CDF entry not above U.
+    int32 Num = Size();
+    int32 Offset = (int32)(::std::upper_bound(CDF.begin(), CDF.end(), U) - CDF.begin()) - 1;
+    Offset = FMath::Clamp(Offset, 0, Num - 1);
+
+    if (OutPDF != nullptr)
+    {
+        *OutPDF = Integral > 0.0f ? Function[Offset] / Integral : 1.0f;
+    }
+    if (OutOffset != nullptr)
+    {
+        *OutOffset = Offset;
+    }
+
+    // Where U lies inside its piece.
+    float Width = CDF[Offset + 1] - CDF[Offset];
+    float Delta = Width > 0.0f ? (U - CDF[Offset]) / Width : 0.0f;
+    return FMath::Min((Offset + Delta) / Num, ONE_MINUS_EPSILON);
+}
+
+FDistribution2D::FDistribution2D(const float* Weights, int32 Width, int32 Height)
+{
+    Conditionals.reserve((::std::size_t)Height);
+    TArray<float> RowIntegrals((::std::size_t)Height);
+    for (int32 Row = 0; Row < Height; ++Row)
+    {
+        Conditionals.emplace_back(Weights + (::std::size_t)Row * Width, Width);
+        RowIntegrals[Row] = Conditionals.back().GetIntegral();
+    }
+    Marginal = FDistribution1D(RowIntegrals.data(), Height);
+}
+
+FVector2 FDistribution2D::SampleContinuous(const FVector2& U, float* OutPDF) const
+{
+    float PDFs[2];
+    int32 Row = 0;
+    float Y = Marginal.SampleContinuous(U.Y, &PDFs[1], &Row);
+    float X = Conditionals[Row].SampleContinuous(U.X, &PDFs[0]);
+    if (OutPDF != nullptr)
+    {
+        *OutPDF = PDFs[0] * PDFs[1];
+    }
+    return FVector2(X, Y);
+}
+
+float FDistribution2D::PDF(const FVector2& Point) const
+{
+    int32 Height = Marginal.Size();
+    int32 Row = FMath::Clamp((int32)(Point.Y * Height), 0, Height - 1);
+    const FDistribution1D& Conditional = Conditionals[Row];
+    int32 Column = FMath::Clamp((int32)(Point.X * Conditional.Size()), 0, Conditional.Size() - 1);
+    return Marginal.GetIntegral() > 0.0f ? Conditional.PDF(Column) * Conditional.GetIntegral() / Marginal.GetIntegral() : 0.0f;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+// Piecewise-constant density over [0, 1) with one piece per weight. Unlike FAliasTable it samples by inverting the CDF,
+// so neighbouring random numbers map to neighbouring points and the density is defined everywhere, which continuous
+// domains such as image maps need.
+class FDistribution1D
+{
+public:
+    FDistribution1D() = default;
+    explicit FDistribution1D(const float* Weights, int32 Num);
+
+    // A point in [0, 1) and its density. OutOffset receives the piece it falls in.
+    float SampleContinuous(float U, float* OutPDF = nullptr, int32* OutOffset = nullptr) const;
+
+    // Density of SampleContinuous at a point of the given piece.
+    float PDF(int32 Offset) const { return Integral > 0.0f ? Function[Offset] / Integral : 0.0f; }
+
+    int32 Size() const { return (int32)Function.size(); }
+    float GetIntegral() const { return Integral; }
+
+private:
+    TArray<float> Function;
+    // Num + 1 entries, from 0 to 1.
+    TArray<float> CDF;
+    float Integral = 0.0f;
+};
+
+// Piecewise-constant density over [0, 1)^2 from a Width x Height grid of weights, row by row. Samples pick a row from
+// the marginal density, then a column from that row's conditional density (Pharr et al., "Physically Based Rendering",
+// 13.6.7).
+class FDistribution2D
+{
+public:
+    FDistribution2D() = default;
+    FDistribution2D(const float* Weights, int32 Width, int32 Height);
+
+    // X is along the rows, Y across them.
+    FVector2 SampleContinuous(const FVector2& U, float* OutPDF = nullptr) const;
+    float PDF(const FVector2& Point) const;
+
+    bool IsEmpty() const { return Marginal.GetIntegral() <= 0.0f; }
+
+private:
+    TArray<FDistribution1D> Conditionals;
+    FDistribution1D Marginal;
+};
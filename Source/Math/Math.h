@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cfloat>
 #include <cmath>
 
 #include "CoreDefines.h"
@@ -13,6 +14,7 @@ constexpr float PI_INV = 1.f / PI;
 
 constexpr float FLOAT_MAX = FLT_MAX;
 constexpr float FLOAT_MIN = FLT_MIN;
+constexpr float ONE_MINUS_EPSILON = 0x1.fffffep-1f;
 
 class FMath
 {
@@ -40,6 +42,8 @@ public:
 
     static FORCEINLINE float Atan(float Value) { return atanf(Value); }
     static FORCEINLINE double Atan(double Value) { return atan(Value); }
+    static FORCEINLINE float Atan2(float Y, float X) { return atan2f(Y, X); }
+    static FORCEINLINE double Atan2(double Y, double X) { return atan2(Y, X); }
 
     static FORCEINLINE float Sqrt(float Value) { return sqrtf(Value); }
     static FORCEINLINE double Sqrt(double Value) { return sqrt(Value); }
@@ -47,15 +51,23 @@ public:
     static FORCEINLINE float Pow(float A, float B) { return powf(A, B); }
     static FORCEINLINE double Pow(double A, double B) { return pow(A, B); }
 
+    static FORCEINLINE float Exp(float Value) { return expf(Value); }
+    static FORCEINLINE double Exp(double Value) { return exp(Value); }
+
+    static FORCEINLINE float Log2(float Value) { return log2f(Value); }
+    static FORCEINLINE double Log2(double Value) { return log2(Value); }
+
     static FORCEINLINE float InvSqrt(float F) { return 1.0f / sqrtf(F); }
     static FORCEINLINE double InvSqrt(double F) { return 1.0 / sqrt(F); }
 
-    static FORCEINLINE float Floor(float Value) { return std::floorf(Value); }
+    static FORCEINLINE float Floor(float Value) { return floorf(Value); }
     static FORCEINLINE double Floor(double Value) { return std::floor(Value); }
 
-    static FORCEINLINE float Ceil(float Value) { return std::ceilf(Value); }
+    static FORCEINLINE float Ceil(float Value) { return ceilf(Value); }
     static FORCEINLINE double Ceil(double Value) { return std::ceil(Value); }
 
+    static FORCEINLINE float Frac(float Value) { return Value - Floor(Value); }
+
     template <typename T>
     static constexpr FORCEINLINE T Clamp(const T Value, const T Min, const T Max)
     {
@@ -105,8 +117,4 @@ public:
         A = B;
         B = Temp;
     }
-
-    static FORCEINLINE float RandomFloat() { return (float)rand() / RAND_MAX; }
-
-    static FORCEINLINE float RandomFloat(float Min, float Max) { return Min + (Max - Min) * RandomFloat(); }
 };
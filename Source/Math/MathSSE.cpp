@@ -3,6 +3,8 @@
 #include "Math/Matrix.h"
 #include "MathSSE.h"
 
+#include <cstring>
+
 namespace Math::SSE
 {
 static const uint32 stb_fp32_to_srgb8_tab4[104] = {
@@ -21,7 +23,7 @@ static const uint32 stb_fp32_to_srgb8_tab4[104] = {
     0x5e0c0a23, 0x631c0980, 0x67db08f6, 0x6c55087f, 0x70940818, 0x74a007bd, 0x787d076c, 0x7c330723,
 };
 
-void SSE::VectorMatrixMultiply(FVector4f* Result, const FVector4f* Vector, const FMatrix4f* Matrix)
+void VectorMatrixMultiply(FVector4f* Result, const FVector4f* Vector, const FMatrix4f* Matrix)
 {
     const __m128* V = (const __m128*)Vector;
     const __m128* M = (const __m128*)Matrix;
@@ -69,7 +71,7 @@ void MatrixMultiply(FMatrix4f* Result, const FMatrix4f* Matrix1, const FMatrix4f
     R[3] = RT;
 }
 
-void SSE::MatrixInverse(FMatrix4f* DstMatrix, const FMatrix4f* SrcMatrix)
+void MatrixInverse(FMatrix4f* DstMatrix, const FMatrix4f* SrcMatrix)
 {
     using Float4x4 = float[4][4];
 
@@ -130,7 +132,7 @@ void SSE::MatrixInverse(FMatrix4f* DstMatrix, const FMatrix4f* SrcMatrix)
     memcpy(DstMatrix, &Result, sizeof(Result));
 }
 
-int SSE::ConvertLinearToSRGB(const float* LinearColor)
+int ConvertLinearToSRGB(const float* LinearColor)
 {
     const __m128 RGBA = VectorLoad(LinearColor);
 
@@ -194,4 +196,21 @@ int SSE::ConvertLinearToSRGB(const float* LinearColor)
     return _mm_cvtsi128_si32(Packed8);
 }
 
+__m128i ConvertLinearToSRGB(const __m128& Linear)
+{
+    // The clamping, table index and interpolation of the single color version, applied to all four lanes.
+    const __m128 AlmostOne = _mm_castsi128_ps(_mm_set1_epi32(0x3f7fffff));
+    const __m128i MinValInt = _mm_set1_epi32((127 - 13) << 23);
+    const __m128 Clamped = _mm_min_ps(_mm_max_ps(Linear, _mm_castsi128_ps(MinValInt)), AlmostOne);
+
+    alignas(16) uint32 TabIndices[4];
+    _mm_store_si128((__m128i*)TabIndices, _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(Clamped), MinValInt), 20));
+    const __m128i TabVals = _mm_setr_epi32(stb_fp32_to_srgb8_tab4[TabIndices[0]], stb_fp32_to_srgb8_tab4[TabIndices[1]],
+                                           stb_fp32_to_srgb8_tab4[TabIndices[2]], stb_fp32_to_srgb8_tab4[TabIndices[3]]);
+
+    const __m128i MantissaLerpFactor = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(Clamped), 12), _mm_set1_epi32(0xff));
+    const __m128i FinalMultiplier = _mm_or_si128(MantissaLerpFactor, _mm_set1_epi32(512 << 16));
+    return _mm_srli_epi32(_mm_madd_epi16(TabVals, FinalMultiplier), 16);
+}
+
 } // namespace Math::SSE
@@ -47,6 +47,10 @@ void MatrixInverse(FMatrix4f* DstMatrix, const FMatrix4f* SrcMatrix);
 
 int ConvertLinearToSRGB(const float* LinearColor);
 
+// Four values of one channel at once, with the same table and rounding as ConvertLinearToSRGB. Each lane of the result
+// holds its 8-bit sRGB value.
+__m128i ConvertLinearToSRGB(const __m128& Linear);
+
 } // namespace SSE
 
 } // namespace Math
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreDefines.h"
+
+// PCG32 random number generator (O'Neill 2014, "PCG: A Family of Simple Fast Space-Efficient Statistically Good Algorithms").
+// 64 bits of state, a selectable stream, and a 32-bit output. Cheap enough to be reseeded for every pixel sample.
+struct FRandomStream
+{
+public:
+    FRandomStream() : State(DefaultState), Increment(DefaultIncrement) {}
+    FRandomStream(uint64 SequenceIndex, uint64 Seed) { SetSequence(SequenceIndex, Seed); }
+
+    // Select the stream (SequenceIndex) and the starting point inside it (Seed).
+    FORCEINLINE void SetSequence(uint64 SequenceIndex, uint64 Seed)
+    {
+        State = 0u;
+        Increment = (SequenceIndex << 1u) | 1u;
+        NextUInt32();
+        State += MixBits(Seed);
+        NextUInt32();
+    }
+
+    FORCEINLINE uint32 NextUInt32()
+    {
+        uint64 OldState = State;
+        State = OldState * Multiplier + Increment;
+
+        uint32 XorShifted = (uint32)(((OldState >> 18u) ^ OldState) >> 27u);
+        uint32 Rotation = (uint32)(OldState >> 59u);
+        return (XorShifted >> Rotation) | (XorShifted << ((~Rotation + 1u) & 31u));
+    }
+
+    // Uniform float in [0, 1).
+    FORCEINLINE float NextFloat()
+    {
+        // The 24 high bits fill the float mantissa exactly, so the result never rounds up to 1.
+        return (float)(NextUInt32() >> 8) * 0x1p-24f;
+    }
+
+    // Skip Delta outputs in O(log Delta) (Brown 1994, "Random Number Generation with Arbitrary Strides").
+    FORCEINLINE void Advance(uint64 Delta)
+    {
+        uint64 CurrentMultiplier = Multiplier;
+        uint64 CurrentIncrement = Increment;
+        uint64 AccumulatedMultiplier = 1u;
+        uint64 AccumulatedIncrement = 0u;
+        while (Delta > 0)
+        {
+            if (Delta & 1u)
+            {
+                AccumulatedMultiplier *= CurrentMultiplier;
+                AccumulatedIncrement = AccumulatedIncrement * CurrentMultiplier + CurrentIncrement;
+            }
+            CurrentIncrement = (CurrentMultiplier + 1u) * CurrentIncrement;
+            CurrentMultiplier *= CurrentMultiplier;
+            Delta >>= 1u;
+        }
+        State = AccumulatedMultiplier * State + AccumulatedIncrement;
+    }
+
+    uint64 GetState() const { return State; }
+    uint64 GetIncrement() const { return Increment; }
+
+    // SplitMix64 finalizer. Spreads neighbouring seeds (pixel indices, sample indices) over the whole state space.
+    static FORCEINLINE uint64 MixBits(uint64 Value)
+    {
+        Value ^= Value >> 31u;
+        Value *= 0x7fb5d329728ea185ull;
+        Value ^= Value >> 27u;
+        Value *= 0x81dadef4bc2dd44dull;
+        Value ^= Value >> 33u;
+        return Value;
+    }
+
+private:
+    static constexpr uint64 DefaultState = 0x853c49e6748fea9bull;
+    static constexpr uint64 DefaultIncrement = 0xda3e39cb94b95bdbull;
+    static constexpr uint64 Multiplier = 0x5851f42d4c957f2dull;
+
+    uint64 State;
+    uint64 Increment;
+};
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include "Geometry/Geometry.h"
 #include "RayTracing/HitResult.h"
+#include "RayTracing/RayPacket.h"
 
 // ********************
 //       BVH Node
@@ -86,47 +87,102 @@ FBVHNode* FBoundingVolumeHierarchy::BuildBVH(TArray<FGeometry*>& Primitives, int
     return BVHNode;
 }
 
-void FBoundingVolumeHierarchy::LineTrace(FHitResult& OutHitResult, const FRay& Ray)
+void FBoundingVolumeHierarchy::LineTrace(FHitRecord& InOutRecord, const FRay& Ray)
 {
-    LineTrace(OutHitResult, Root, Ray);
+    LineTrace(InOutRecord, Root, Ray);
 }
 
-void FBoundingVolumeHierarchy::LineTrace(FHitResult& OutHitResult, const FBVHNode* Node, const FRay& Ray)
+void FBoundingVolumeHierarchy::LineTrace(FHitRecord& InOutRecord, const FBVHNode* Node, const FRay& Ray)
 {
     if (Node != nullptr && Node->BoundingBox.IsIntersecting(Ray))
     {
         // leaf node.
         if (Node->Object != nullptr)
         {
-            Node->Object->LineTrace(OutHitResult, Ray);
+            Node->Object->LineTrace(InOutRecord, Ray);
             return;
         }
 
-        FHitResult LeftHit, RightHit;
-        LineTrace(LeftHit, Node->Left, Ray);
-        LineTrace(RightHit, Node->Right, Ray);
+        // One record for the whole traversal. Left before right, so of equally close hits the right one wins.
+        LineTrace(InOutRecord, Node->Left, Ray);
+        LineTrace(InOutRecord, Node->Right, Ray);
+    }
+}
+
+void FBoundingVolumeHierarchy::LineTracePacket(FRayPacket& Packet, uint32 ActiveMask)
+{
+    if (Packet.bCoherent)
+    {
+        LineTracePacket(Packet, Root, ActiveMask);
+        return;
+    }
+
+    // Rays going in different directions share few nodes: trace them alone.
+    for (int32 Index = 0; Index < Packet.Num; ++Index)
+    {
+        if (ActiveMask & (1u << Index))
+        {
+            LineTrace(Packet.Hits[Index], Root, Packet.Rays[Index]);
+        }
+    }
+}
+
+void FBoundingVolumeHierarchy::LineTracePacket(FRayPacket& Packet, const FBVHNode* Node, uint32 ActiveMask)
+{
+    if (Node == nullptr)
+    {
+        return;
+    }
+
+    // A lone ray is cheaper to trace without the packet tests.
+    if (FRayPacket::CountRays(ActiveMask) == 1)
+    {
+        int32 Index = 0;
+        while ((ActiveMask & (1u << Index)) == 0)
+        {
+            ++Index;
+        }
+        LineTrace(Packet.Hits[Index], Node, Packet.Rays[Index]);
+        return;
+    }
 
-        OutHitResult = LeftHit.Time < RightHit.Time ? LeftHit : RightHit;
+    uint32 HitMask = Node->BoundingBox.IsIntersecting(Packet, ActiveMask);
+    if (HitMask == 0)
+    {
+        return;
+    }
+
+    // leaf node.
+    if (Node->Object != nullptr)
+    {
+        Node->Object->LineTracePacket(Packet, HitMask);
+        return;
     }
+
+    // Left before right, as in LineTrace, so ties resolve the same way.
+    LineTracePacket(Packet, Node->Left, HitMask);
+    LineTracePacket(Packet, Node->Right, HitMask);
 }
 
-void FBoundingVolumeHierarchy::Sample(FHitResult& OutHitResultm, float& OutPDF)
+void FBoundingVolumeHierarchy::Sample(FHitResult& OutHitResultm, float& OutPDF, const FVector2& U)
 {
-    float P = FMath::Sqrt(FMath::RandomFloat()) * Root->Area;
-    Sample(OutHitResultm, OutPDF, Root, P);
+    float P = U.X * Root->Area;
+    Sample(OutHitResultm, OutPDF, Root, P, U.Y);
     OutPDF /= Root->Area;
 }
 
-void FBoundingVolumeHierarchy::Sample(FHitResult& OutHitResult, float& OutPDF, const FBVHNode* Node, float P)
+void FBoundingVolumeHierarchy::Sample(FHitResult& OutHitResult, float& OutPDF, const FBVHNode* Node, float P, float V)
 {
     if (Node->Object != nullptr)
     {
-        Node->Object->Sample(OutHitResult, OutPDF);
+        // Reuse the part of P that falls inside this leaf as a fresh uniform number.
+        float LeafU = FMath::Min(P / Node->Area, ONE_MINUS_EPSILON);
+        Node->Object->Sample(OutHitResult, OutPDF, FVector2(LeafU, V));
         OutPDF *= Node->Area;
         return;
     }
-    P < Node->Left->Area ? Sample(OutHitResult, OutPDF, Node->Left, P) //
-                         : Sample(OutHitResult, OutPDF, Node->Right, P - Node->Left->Area);
+    P < Node->Left->Area ? Sample(OutHitResult, OutPDF, Node->Left, P, V) //
+                         : Sample(OutHitResult, OutPDF, Node->Right, P - Node->Left->Area, V);
 }
 
 static int32 NodeNum = 0;
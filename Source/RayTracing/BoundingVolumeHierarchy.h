@@ -4,8 +4,10 @@
 #include "Geometry/BoundingBox.h"
 
 class FGeometry;
+struct FHitRecord;
 struct FHitResult;
 struct FRay;
+struct FRayPacket;
 
 struct FBVHNode
 {
@@ -28,12 +30,18 @@ public:
 
     FBVHNode* BuildBVH(TArray<FGeometry*>& Primitives, int32 Start, int32 End);
 
-    void LineTrace(FHitResult& OutHitResult, const FRay& Ray);
-    void Sample(FHitResult& OutHitResultm, float& OutPDF);
+    // Closest hit of Ray, replacing InOutRecord only if no farther.
+    void LineTrace(FHitRecord& InOutRecord, const FRay& Ray);
+    // Trace the rays of ActiveMask together while they stay coherent, keeping their closest hits in Packet.Hits.
+    void LineTracePacket(FRayPacket& Packet, uint32 ActiveMask);
+    void Sample(FHitResult& OutHitResultm, float& OutPDF, const FVector2& U);
+
+    FBoundingBox GetBoundingBox() const { return Root != nullptr ? Root->BoundingBox : FBoundingBox(); }
 
 private:
-    void LineTrace(FHitResult& OutHitResult, const FBVHNode* Node, const FRay& Ray);
-    void Sample(FHitResult& OutHitResult, float& OutPDF, const FBVHNode* Node, float P);
+    void LineTrace(FHitRecord& InOutRecord, const FBVHNode* Node, const FRay& Ray);
+    void LineTracePacket(FRayPacket& Packet, const FBVHNode* Node, uint32 ActiveMask);
+    void Sample(FHitResult& OutHitResult, float& OutPDF, const FBVHNode* Node, float P, float V);
 
 private:
     FBVHNode* Root;
@@ -2,12 +2,32 @@
 
 #include "CoreTypes.h"
 
+// What BVH traversal keeps per ray: enough to find the hit again. The full FHitResult is built once, for the closest hit.
+struct FHitRecord
+{
+    float Time = FLOAT_MAX;
+    // Weights of the primitive's three vertices at the hit.
+    FVector Barycentrics = FVector::ZeroVector;
+    // The leaf primitive hit, nullptr on a miss.
+    class FGeometry* Primitive = nullptr;
+
+    bool IsHit() const { return Primitive != nullptr; }
+};
+
 struct FHitResult
 {
     bool bHit = false;
     float Time = FLOAT_MAX;
     FVector Location = FVector::ZeroVector;
+    // Geometric normal: the side rays leave from and light cosines.
     FVector Normal = FVector::ZeroVector;
+    // Interpolated vertex normal on the side of Normal: BSDF evaluation.
+    FVector ShadingNormal = FVector::ZeroVector;
+    FVector2 TexCoord = FVector2::ZeroVector;
+    // Texture coordinate units per world unit around the hit, to turn a ray footprint into a texture footprint.
+    float TexCoordDensity = 0.0f;
+    // Diffuse reflectance with textures applied. Set by the renderer, which knows the ray footprint.
+    FVector Albedo = FVector::ZeroVector;
     FVector Emission = FVector::ZeroVector;
 
     class FGeometry* Object = nullptr;
@@ -0,0 +1,253 @@
+#include "RayTracing/LightBVH.h"
+#include "Geometry/Geometry.h"
+
+#include <algorithm>
+
+// cos(max(0, A - B)) and sin(max(0, A - B)) from the sines and cosines of A and B.
+static FORCEINLINE float CosSubClamped(float SinA, float CosA, float SinB, float CosB)
+{
+    return CosA > CosB ? 1.0f : CosA * CosB + SinA * SinB;
+}
+
+static FORCEINLINE float SinSubClamped(float SinA, float CosA, float SinB, float CosB)
+{
+    return CosA > CosB ? 0.0f : SinA * CosB - CosA * SinB;
+}
+
+static FORCEINLINE float SinFromCos(float Cos)
+{
+    return FMath::Sqrt(FMath::Max(0.0f, 1.0f - Cos * Cos));
+}
+
+// ********************
+//     Light bounds
+// ********************
+
+float FLightBounds::Importance(const FVector& Point, const FVector& Normal) const
+{
+    FVector Center = Bounds.Centroid();
+    FVector Offset = Point - Center;
+    float Distance2 = Offset.SquaredLength();
+    FVector Wi = Offset.GetSafeNormal();
+
+    // Angle between the axis and the direction to Point, and the half angle the bounds cover seen from Point.
+    float CosThetaW = FVector::DotProduct(Axis, Wi);
+    float SinThetaW = SinFromCos(CosThetaW);
+    float Radius2 = (Bounds.Diagonal() * 0.5f).SquaredLength();
+    float CosThetaB = Distance2 < Radius2 ? -1.0f : FMath::Sqrt(1.0f - Radius2 / Distance2);
+    float SinThetaB = SinFromCos(CosThetaB);
+
+    // The smallest angle between Wi and any emitter normal, from any point of the bounds.
+    float SinThetaO = SinFromCos(CosThetaO);
+    float CosThetaX = CosSubClamped(SinThetaW, CosThetaW, SinThetaO, CosThetaO);
+    float SinThetaX = SinSubClamped(SinThetaW, CosThetaW, SinThetaO, CosThetaO);
+    float CosThetaP = CosSubClamped(SinThetaX, CosThetaX, SinThetaB, CosThetaB);
+    if (CosThetaP <= CosThetaE)
+    {
+        return 0.0f;
+    }
+
+    // Surfaces only receive light from the side Normal faces.
+    float CosThetaI = -FVector::DotProduct(Wi, Normal);
+    float CosThetaPI = CosSubClamped(SinFromCos(CosThetaI), CosThetaI, SinThetaB, CosThetaB);
+    if (CosThetaPI <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // Inside or close to the bounds the distance says little, so it is clamped by their size.
+    float ClampedDistance2 = FMath::Max(Distance2, Bounds.Diagonal().Length() * 0.5f);
+    return Phi * CosThetaP * CosThetaPI / ClampedDistance2;
+}
+
+FLightBounds FLightBounds::Union(const FLightBounds& A, const FLightBounds& B)
+{
+    if (A.Phi <= 0.0f)
+    {
+        return B;
+    }
+    if (B.Phi <= 0.0f)
+    {
+        return A;
+    }
+
+    FLightBounds Result;
+    Result.Bounds = A.Bounds | B.Bounds;
+    Result.Phi = A.Phi + B.Phi;
+    Result.CosThetaE = FMath::Min(A.CosThetaE, B.CosThetaE);
+
+    // The smallest cone around both normal cones.
+    float ThetaA = FMath::Acos(A.CosThetaO);
+    float ThetaB = FMath::Acos(B.CosThetaO);
+    float ThetaD = FMath::Acos(FVector::DotProduct(A.Axis, B.Axis));
+    if (FMath::Min(ThetaD + ThetaB, PI) <= ThetaA)
+    {
+        Result.Axis = A.Axis;
+        Result.CosThetaO = A.CosThetaO;
+        return Result;
+    }
+    if (FMath::Min(ThetaD + ThetaA, PI) <= ThetaB)
+    {
+        Result.Axis = B.Axis;
+        Result.CosThetaO = B.CosThetaO;
+        return Result;
+    }
+
+    float ThetaO = 0.5f * (ThetaA + ThetaD + ThetaB);
+    FVector RotationAxis = FVector::CrossProduct(A.Axis, B.Axis);
+    if (ThetaO >= PI || RotationAxis.SquaredLength() <= 0.0f)
+    {
+        Result.Axis = A.Axis;
+        Result.CosThetaO = -1.0f;
+        return Result;
+    }
+
+    // Rotate A's axis towards B's by ThetaO - ThetaA (Rodrigues' formula).
+    RotationAxis = RotationAxis.GetSafeNormal();
+    float ThetaR = ThetaO - ThetaA;
+    float CosR = FMath::Cos(ThetaR), SinR = FMath::Sin(ThetaR);
+    Result.Axis = (A.Axis * CosR + FVector::CrossProduct(RotationAxis, A.Axis) * SinR +
+                   RotationAxis * (FVector::DotProduct(RotationAxis, A.Axis) * (1.0f - CosR)))
+                      .GetSafeNormal();
+    Result.CosThetaO = FMath::Cos(ThetaO);
+    return Result;
+}
+
+// ********************
+//      Light BVH
+// ********************
+
+FLightBVH::FLightBVH(const TArray<FGeometry*>& InLights) : Lights(&InLights)
+{
+    // Lights that emit nothing are never sampled.
+    TArray<FLightBounds> Bounds(InLights.size());
+    TArray<int32> Indices;
+    for (int32 Index = 0; Index < (int32)InLights.size(); ++Index)
+    {
+        if (!InLights[Index]->GetLightBounds(Bounds[Index]))
+        {
+            // Anything but a triangle: bounded by its box, emitting everywhere, with power as if per unit area.
+            Bounds[Index].Bounds = InLights[Index]->GetBoundingBox();
+            Bounds[Index].Phi = InLights[Index]->GetArea();
+            Bounds[Index].CosThetaE = -1.0f;
+        }
+        if (Bounds[Index].Phi > 0.0f)
+        {
+            Indices.emplace_back(Index);
+        }
+    }
+
+    if (!Indices.empty())
+    {
+        Nodes.reserve(2 * Indices.size() - 1);
+        Build(Indices, Bounds, 0, (int32)Indices.size(), 0, 0);
+    }
+}
+
+void FLightBVH::Build(TArray<int32>& Indices, const TArray<FLightBounds>& Bounds, int32 Begin, int32 End, uint64 BitTrail, int32 Depth)
+{
+    int32 NodeIndex = (int32)Nodes.size();
+    Nodes.emplace_back();
+
+    // Sixty-four levels hold far more lights than a median split ever needs.
+    if (End - Begin == 1 || Depth >= 63)
+    {
+        FLightBVHNode& Leaf = Nodes[NodeIndex];
+        Leaf.LightBounds = Bounds[Indices[Begin]];
+        Leaf.Index = Indices[Begin];
+        Leaf.bLeaf = true;
+        BitTrails[(*Lights)[Indices[Begin]]] = BitTrail;
+        return;
+    }
+
+    // Split at the median centroid along the longest axis, like the scene BVH.
+    FBoundingBox CentroidBounds;
+    for (int32 i = Begin; i < End; ++i)
+    {
+        CentroidBounds |= Bounds[Indices[i]].Bounds.Centroid();
+    }
+    int32 Dim = CentroidBounds.MaxAxis();
+    int32 Mid = (Begin + End) / 2;
+    ::std::nth_element(Indices.begin() + Begin, Indices.begin() + Mid, Indices.begin() + End,
+        [&](int32 A, int32 B) { return Bounds[A].Bounds.Centroid()[Dim] < Bounds[B].Bounds.Centroid()[Dim]; });
+
+    Build(Indices, Bounds, Begin, Mid, BitTrail, Depth + 1);
+    int32 SecondChild = (int32)Nodes.size();
+    Build(Indices, Bounds, Mid, End, BitTrail | (1ull << Depth), Depth + 1);
+
+    FLightBVHNode& Node = Nodes[NodeIndex];
+    Node.LightBounds = FLightBounds::Union(Nodes[NodeIndex + 1].LightBounds, Nodes[SecondChild].LightBounds);
+    Node.Index = SecondChild;
+}
+
+int32 FLightBVH::Sample(const FVector& Point, const FVector& Normal, float U, float* OutPMF) const
+{
+    if (Nodes.empty() || Nodes[0].LightBounds.Importance(Point, Normal) <= 0.0f)
+    {
+        return -1;
+    }
+
+    float PMF = 1.0f;
+    int32 NodeIndex = 0;
+    while (!Nodes[NodeIndex].bLeaf)
+    {
+        int32 Children[2] = {NodeIndex + 1, Nodes[NodeIndex].Index};
+        float Importance0 = Nodes[Children[0]].LightBounds.Importance(Point, Normal);
+        float Importance1 = Nodes[Children[1]].LightBounds.Importance(Point, Normal);
+        if (Importance0 <= 0.0f && Importance1 <= 0.0f)
+        {
+            return -1;
+        }
+
+        // Pick a child and reuse the rest of U further down.
+        float P0 = Importance0 / (Importance0 + Importance1);
+        if (U < P0)
+        {
+            NodeIndex = Children[0];
+            U = FMath::Min(U / P0, ONE_MINUS_EPSILON);
+            PMF *= P0;
+        }
+        else
+        {
+            NodeIndex = Children[1];
+            U = FMath::Min((U - P0) / (1.0f - P0), ONE_MINUS_EPSILON);
+            PMF *= 1.0f - P0;
+        }
+    }
+
+    if (OutPMF != nullptr)
+    {
+        *OutPMF = PMF;
+    }
+    return Nodes[NodeIndex].Index;
+}
+
+float FLightBVH::PMF(const FVector& Point, const FVector& Normal, const FGeometry* Light) const
+{
+    auto It = BitTrails.find(Light);
+    if (It == BitTrails.end() || Nodes[0].LightBounds.Importance(Point, Normal) <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // Retrace the choices Sample makes on the way to the light.
+    uint64 BitTrail = It->second;
+    float PMF = 1.0f;
+    int32 NodeIndex = 0;
+    while (!Nodes[NodeIndex].bLeaf)
+    {
+        int32 Children[2] = {NodeIndex + 1, Nodes[NodeIndex].Index};
+        float Importance0 = Nodes[Children[0]].LightBounds.Importance(Point, Normal);
+        float Importance1 = Nodes[Children[1]].LightBounds.Importance(Point, Normal);
+        if (Importance0 <= 0.0f && Importance1 <= 0.0f)
+        {
+            return 0.0f;
+        }
+
+        int32 Child = (int32)(BitTrail & 1);
+        PMF *= (Child == 0 ? Importance0 : Importance1) / (Importance0 + Importance1);
+        NodeIndex = Children[Child];
+        BitTrail >>= 1;
+    }
+    return PMF;
+}
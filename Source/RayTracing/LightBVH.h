@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "Geometry/BoundingBox.h"
+
+#include <unordered_map>
+
+class FGeometry;
+
+// Where a set of emitters is, which way it emits and how much (Conty Estevez and Kulla 2018, "Importance Sampling of Many
+// Lights with Adaptive Tree Splitting").
+struct FLightBounds
+{
+    FBoundingBox Bounds;
+    // The emitters' normals lie within acos(CosThetaO) of Axis, and each of them emits up to acos(CosThetaE) away from its
+    // normal: 90 degrees for a one-sided area light.
+    FVector Axis = FVector(0.0f, 0.0f, 1.0f);
+    float CosThetaO = -1.0f;
+    float CosThetaE = 0.0f;
+    // Emitted power, up to a constant factor.
+    float Phi = 0.0f;
+
+    // Conservative estimate of the light arriving at Point on a surface facing Normal, zero only if none can
+    // (Pharr et al., "Physically Based Rendering", 4th edition, 12.6.3).
+    float Importance(const FVector& Point, const FVector& Normal) const;
+
+    static FLightBounds Union(const FLightBounds& A, const FLightBounds& B);
+};
+
+struct FLightBVHNode
+{
+    FLightBounds LightBounds;
+    // Leaves: the light's index. Interior nodes: the second child's node index, the first child follows the node.
+    int32 Index = -1;
+    bool bLeaf = false;
+};
+
+// Binary tree over the emissive primitives for sampling lights by their importance at the shading point. Each step down
+// picks a child by its importance, so nearby lights facing the point get most of the samples, at O(log N) cost.
+class FLightBVH
+{
+public:
+    explicit FLightBVH(const TArray<FGeometry*>& Lights);
+
+    // Pick a light for a surface at Point facing Normal. Returns its index in Lights and its probability, or -1 if no light
+    // can reach Point.
+    int32 Sample(const FVector& Point, const FVector& Normal, float U, float* OutPMF = nullptr) const;
+    // Probability that Sample picks Light.
+    float PMF(const FVector& Point, const FVector& Normal, const FGeometry* Light) const;
+
+    bool IsEmpty() const { return Nodes.empty(); }
+
+private:
+    // Build the subtree of Indices[Begin, End) at the end of Nodes. BitTrail holds the branches taken from the root.
+    void Build(TArray<int32>& Indices, const TArray<FLightBounds>& Bounds, int32 Begin, int32 End, uint64 BitTrail, int32 Depth);
+
+private:
+    TArray<FLightBVHNode> Nodes;
+    const TArray<FGeometry*>* Lights = nullptr;
+    // Bit i set: the light's leaf lies below the second child at depth i.
+    ::std::unordered_map<const FGeometry*, uint64> BitTrails;
+};
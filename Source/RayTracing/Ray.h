@@ -2,6 +2,8 @@
 
 #include "CoreTypes.h"
 
+#include <cstring>
+
 struct FRay
 {
     FVector Origin;
@@ -21,4 +23,46 @@ struct FRay
     {
         return Origin + Direction * T;
     }
+
+    // A ray leaving the surface at Location. The origin is pushed off the surface along the geometric normal, to the side
+    // Direction points to, by a fixed number of ulps of Location, so it clears the rounding error of the hit point at any
+    // scale (Waechter and Binder 2019, "A Fast and Robust Method for Avoiding Self-Intersection").
+    static FRay SpawnFromSurface(const FVector& Location, const FVector& Normal, const FVector& Direction)
+    {
+        FVector OffsetNormal = FVector::DotProduct(Direction, Normal) < 0.0f ? -Normal : Normal;
+
+        FVector OffsetOrigin;
+        for (int32 Axis = 0; Axis < 3; ++Axis)
+        {
+            float Position = Location[Axis];
+            int32 UlpOffset = (int32)(256.0f * OffsetNormal[Axis]);
+
+            int32 Bits;
+            ::std::memcpy(&Bits, &Position, sizeof(Bits));
+            Bits += Position < 0.0f ? -UlpOffset : UlpOffset;
+            float OffsetPosition;
+            ::std::memcpy(&OffsetPosition, &Bits, sizeof(Bits));
+
+            // Near zero ulps are tiny, so a small absolute offset is used instead.
+            OffsetOrigin[Axis] = FMath::Abs(Position) < 1.0f / 32.0f ? Position + OffsetNormal[Axis] / 65536.0f : OffsetPosition;
+        }
+        return FRay(OffsetOrigin, Direction);
+    }
+};
+
+// The footprint of a pixel carried along a path, for texture filtering (Akenine-Moller et al. 2019, "Texture Level of
+// Detail Strategies for Real-Time Ray Tracing"). The cone is Width wide where the ray starts and widens by SpreadAngle
+// per unit of distance.
+struct FRayCone
+{
+    float Width = 0.0f;
+    float SpreadAngle = 0.0f;
+
+    FRayCone() {}
+    FRayCone(float InWidth, float InSpreadAngle) : Width(InWidth), SpreadAngle(InSpreadAngle) {}
+
+    float GetWidth(float Distance) const { return Width + SpreadAngle * Distance; }
+
+    // The cone reflected at Distance by a surface that widens it by BounceSpreadAngle.
+    FRayCone Bounce(float Distance, float BounceSpreadAngle) const { return FRayCone(GetWidth(Distance), SpreadAngle + BounceSpreadAngle); }
 };
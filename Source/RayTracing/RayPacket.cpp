@@ -0,0 +1,39 @@
+#include "RayTracing/RayPacket.h"
+
+void FRayPacket::Finalize()
+{
+    for (int32 Lane = 0; Lane < RayPacketSize; ++Lane)
+    {
+        const FRay& Ray = Rays[Lane < Num ? Lane : 0];
+        for (int32 Axis = 0; Axis < 3; ++Axis)
+        {
+            Origin[Axis][Lane] = Ray.Origin[Axis];
+            Direction[Axis][Lane] = Ray.Direction[Axis];
+        }
+    }
+
+    bCoherent = Num > 1;
+    for (int32 Axis = 0; Axis < 3 && bCoherent; ++Axis)
+    {
+        bNegativeAxis[Axis] = Rays[0].Direction[Axis] < 0.0f;
+        float Sign = bNegativeAxis[Axis] ? -1.0f : 1.0f;
+
+        MinOrigin[Axis] = MaxOrigin[Axis] = Sign * Rays[0].Origin[Axis];
+        MinDirection[Axis] = MaxDirection[Axis] = Sign * Rays[0].Direction[Axis];
+        for (int32 Index = 0; Index < Num; ++Index)
+        {
+            float MirroredOrigin = Sign * Rays[Index].Origin[Axis];
+            float MirroredDirection = Sign * Rays[Index].Direction[Axis];
+            // Zero components divide to infinities in the bounds test, so they break coherence too.
+            if (!(MirroredDirection > 0.0f))
+            {
+                bCoherent = false;
+                break;
+            }
+            MinOrigin[Axis] = FMath::Min(MinOrigin[Axis], MirroredOrigin);
+            MaxOrigin[Axis] = FMath::Max(MaxOrigin[Axis], MirroredOrigin);
+            MinDirection[Axis] = FMath::Min(MinDirection[Axis], MirroredDirection);
+            MaxDirection[Axis] = FMath::Max(MaxDirection[Axis], MirroredDirection);
+        }
+    }
+}
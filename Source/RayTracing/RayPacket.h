@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "RayTracing/HitResult.h"
+#include "RayTracing/Ray.h"
+
+// Rays per packet. A multiple of 4, the SSE width.
+static constexpr int32 RayPacketSize = 8;
+
+// A bundle of rays traced through the BVH together: each node's bounds are tested against four rays per SSE instruction,
+// and a coherent packet can reject a node it misses entirely with one interval test (Boulos et al. 2006, "Geometric and
+// Arithmetic Culling Methods for Entire Ray Packets"). Hits are exactly the ones single-ray traversal finds.
+struct alignas(16) FRayPacket
+{
+public:
+    void Clear() { Num = 0; }
+    void AddRay(const FRay& Ray)
+    {
+        Rays[Num] = Ray;
+        Hits[Num] = FHitRecord();
+        ++Num;
+    }
+
+    // Fill the SSE lanes and the culling interval once all rays are added.
+    void Finalize();
+
+    uint32 GetFullMask() const { return (1u << Num) - 1; }
+
+    static FORCEINLINE int32 CountRays(uint32 Mask)
+    {
+        int32 Count = 0;
+        for (; Mask != 0; Mask &= Mask - 1)
+        {
+            ++Count;
+        }
+        return Count;
+    }
+
+public:
+    // Ray data by axis, one SSE register per four lanes. Lanes past Num repeat the first ray.
+    alignas(16) float Origin[3][RayPacketSize];
+    alignas(16) float Direction[3][RayPacketSize];
+
+    // Interval culling needs the direction signs to agree on every axis. Axes where they are all negative are mirrored,
+    // so the bounds below are over positive directions. Without coherence the packet is traced one ray at a time.
+    bool bCoherent = false;
+    bool bNegativeAxis[3];
+    float MinOrigin[3];
+    float MaxOrigin[3];
+    float MinDirection[3];
+    float MaxDirection[3];
+
+    int32 Num = 0;
+    FRay Rays[RayPacketSize];
+    // Closest hit so far of each ray. Resolved to a FHitResult by the caller, if it needs more than the distance.
+    FHitRecord Hits[RayPacketSize];
+};
@@ -0,0 +1,253 @@
+#include "RayTracing/Sampler.h"
+
+FSampler* FSampler::Create(ESamplerType SamplerType, uint32 Seed, int32 ImageWidth)
+{
+    switch (SamplerType)
+    {
+    case ESamplerType::Sobol:
+        return new FSobolSampler(Seed);
+    case ESamplerType::BlueNoiseSobol:
+        return new FBlueNoiseSobolSampler(Seed);
+    case ESamplerType::Independent:
+    default:
+        return new FIndependentSampler(Seed, ImageWidth);
+    }
+}
+
+// ********************
+//     Independent
+// ********************
+
+void FIndependentSampler::StartPixelSample(int32 X, int32 Y, int32 SampleIndex, int32 InDimension)
+{
+    RandomStream.SetSequence((uint64)(Y * PixelStride + X), ((uint64)SampleIndex << 32) | Seed);
+    RandomStream.Advance((uint64)InDimension);
+    Dimension = InDimension;
+}
+
+float FIndependentSampler::Get1D()
+{
+    Dimension += 1;
+    return RandomStream.NextFloat();
+}
+
+FVector2 FIndependentSampler::Get2D()
+{
+    Dimension += 2;
+    float U = RandomStream.NextFloat();
+    float V = RandomStream.NextFloat();
+    return FVector2(U, V);
+}
+
+// ********************
+//        Sobol
+// ********************
+
+static FORCEINLINE float UInt32ToFloat(uint32 Value)
+{
+    return (float)(Value >> 8) * 0x1p-24f;
+}
+
+void FSobolSampler::StartPixelSample(int32 X, int32 Y, int32 InSampleIndex, int32 InDimension)
+{
+    PixelX = X;
+    PixelY = Y;
+    SampleIndex = (uint32)InSampleIndex;
+    Dimension = InDimension;
+    PixelHash = GetPixelHash(X, Y);
+}
+
+float FSobolSampler::Get1D()
+{
+    uint64 Hash = FRandomStream::MixBits(PixelHash ^ (uint64)Dimension);
+    uint32 Index = OwenScramble(SampleIndex, (uint32)Hash);
+
+    // Dimension 0 of Sobol is the van der Corput sequence.
+    uint32 X = OwenScramble(ReverseBits(Index), (uint32)(Hash >> 32));
+
+    float Result = ApplyDither(UInt32ToFloat(X), Dimension);
+    Dimension += 1;
+    return Result;
+}
+
+FVector2 FSobolSampler::Get2D()
+{
+    uint64 Hash = FRandomStream::MixBits(PixelHash ^ (uint64)Dimension);
+    uint32 Index = OwenScramble(SampleIndex, (uint32)Hash);
+
+    // Dimension 1 of Sobol: direction numbers v_i = v_(i-1) ^ (v_(i-1) >> 1).
+    uint32 SobolX = ReverseBits(Index);
+    uint32 SobolY = 0;
+    for (uint32 V = 1u << 31; Index != 0; Index >>= 1, V ^= V >> 1)
+    {
+        if (Index & 1u)
+        {
+            SobolY ^= V;
+        }
+    }
+
+    uint64 ScrambleHash = FRandomStream::MixBits(Hash);
+    float X = ApplyDither(UInt32ToFloat(OwenScramble(SobolX, (uint32)ScrambleHash)), Dimension);
+    float Y = ApplyDither(UInt32ToFloat(OwenScramble(SobolY, (uint32)(ScrambleHash >> 32))), Dimension + 1);
+    Dimension += 2;
+    return FVector2(X, Y);
+}
+
+uint64 FSobolSampler::GetPixelHash(int32 X, int32 Y) const
+{
+    return FRandomStream::MixBits(((uint64)(uint32)Y << 32 | (uint32)X) ^ FRandomStream::MixBits(Seed));
+}
+
+uint32 FSobolSampler::ReverseBits(uint32 Value)
+{
+    Value = (Value << 16) | (Value >> 16);
+    Value = ((Value & 0x00ff00ffu) << 8) | ((Value & 0xff00ff00u) >> 8);
+    Value = ((Value & 0x0f0f0f0fu) << 4) | ((Value & 0xf0f0f0f0u) >> 4);
+    Value = ((Value & 0x33333333u) << 2) | ((Value & 0xccccccccu) >> 2);
+    Value = ((Value & 0x55555555u) << 1) | ((Value & 0xaaaaaaaau) >> 1);
+    return Value;
+}
+
+uint32 FSobolSampler::OwenScramble(uint32 Value, uint32 ScrambleSeed)
+{
+    // Laine-Karras permutation on the reversed bits: every bit is flipped depending only on the bits above it.
+    Value = ReverseBits(Value);
+    Value += ScrambleSeed;
+    Value ^= Value * 0x6c50b47cu;
+    Value ^= Value * 0xb82f1e52u;
+    Value ^= Value * 0xc7afe638u;
+    Value ^= Value * 0x8d22f6e6u;
+    return ReverseBits(Value);
+}
+
+// ********************
+//   Blue noise Sobol
+// ********************
+
+uint64 FBlueNoiseSobolSampler::GetPixelHash(int32 X, int32 Y) const
+{
+    // Same sequence for every pixel. The dither decorrelates them.
+    return FRandomStream::MixBits(Seed);
+}
+
+float FBlueNoiseSobolSampler::ApplyDither(float Value, int32 InDimension) const
+{
+    // Shift the mask per dimension along the R2 sequence so different dimensions see uncorrelated offsets.
+    int32 ShiftX = (int32)(FMath::Frac(0.7548776662f * (InDimension + 1)) * MaskSize);
+    int32 ShiftY = (int32)(FMath::Frac(0.5698402909f * (InDimension + 1)) * MaskSize);
+
+    int32 X = (PixelX + ShiftX) & (MaskSize - 1);
+    int32 Y = (PixelY + ShiftY) & (MaskSize - 1);
+
+    float Result = Value + GetBlueNoiseMask()[Y * MaskSize + X];
+    return Result >= 1.0f ? Result - 1.0f : Result;
+}
+
+const TArray<float>& FBlueNoiseSobolSampler::GetBlueNoiseMask()
+{
+    // Ulichney's void-and-cluster method on a toroidal grid with a Gaussian energy filter.
+    static const TArray<float> Mask = []()
+    {
+        constexpr int32 PixelNum = MaskSize * MaskSize;
+        constexpr int32 KernelRadius = 6;
+        constexpr float Sigma = 1.5f;
+
+        TArray<uint8> Pattern(PixelNum, 0);
+        TArray<float> Energy(PixelNum, 0.0f);
+
+        auto Splat = [&](int32 Index, float Sign)
+        {
+            int32 CX = Index % MaskSize, CY = Index / MaskSize;
+            for (int32 DY = -KernelRadius; DY <= KernelRadius; ++DY)
+            {
+                for (int32 DX = -KernelRadius; DX <= KernelRadius; ++DX)
+                {
+                    int32 X = (CX + DX) & (MaskSize - 1);
+                    int32 Y = (CY + DY) & (MaskSize - 1);
+                    Energy[Y * MaskSize + X] += Sign * FMath::Exp(-(float)(DX * DX + DY * DY) / (2.0f * Sigma * Sigma));
+                }
+            }
+        };
+        auto TightestCluster = [&]()
+        {
+            int32 Best = -1;
+            for (int32 i = 0; i < PixelNum; ++i)
+            {
+                Best = (Pattern[i] && (Best < 0 || Energy[i] > Energy[Best])) ? i : Best;
+            }
+            return Best;
+        };
+        auto LargestVoid = [&]()
+        {
+            int32 Best = -1;
+            for (int32 i = 0; i < PixelNum; ++i)
+            {
+                Best = (!Pattern[i] && (Best < 0 || Energy[i] < Energy[Best])) ? i : Best;
+            }
+            return Best;
+        };
+
+        // Initial binary pattern: 10% random points, relaxed until the tightest cluster is also the largest void.
+        FRandomStream RandomStream(0, 0);
+        int32 OnesNum = 0;
+        while (OnesNum < PixelNum / 10)
+        {
+            int32 Index = (int32)(RandomStream.NextUInt32() % PixelNum);
+            if (!Pattern[Index])
+            {
+                Pattern[Index] = 1;
+                Splat(Index, 1.0f);
+                ++OnesNum;
+            }
+        }
+        for (int32 Iteration = 0; Iteration < PixelNum; ++Iteration)
+        {
+            int32 Cluster = TightestCluster();
+            Pattern[Cluster] = 0;
+            Splat(Cluster, -1.0f);
+
+            int32 Void = LargestVoid();
+            Pattern[Void] = 1;
+            Splat(Void, 1.0f);
+
+            if (Void == Cluster)
+            {
+                break;
+            }
+        }
+
+        TArray<int32> Ranks(PixelNum, 0);
+        TArray<uint8> InitialPattern = Pattern;
+        TArray<float> InitialEnergy = Energy;
+
+        // Phase 1: rank the initial points by removing the tightest cluster first.
+        for (int32 Rank = OnesNum - 1; Rank >= 0; --Rank)
+        {
+            int32 Cluster = TightestCluster();
+            Pattern[Cluster] = 0;
+            Splat(Cluster, -1.0f);
+            Ranks[Cluster] = Rank;
+        }
+
+        // Phase 2 and 3: fill the largest void until the pattern is full.
+        // Filling the largest void of the ones is the same as removing the tightest cluster of the zeros.
+        Pattern = InitialPattern;
+        Energy = InitialEnergy;
+        for (int32 Rank = OnesNum; Rank < PixelNum; ++Rank)
+        {
+            int32 Void = LargestVoid();
+            Pattern[Void] = 1;
+            Splat(Void, 1.0f);
+            Ranks[Void] = Rank;
+        }
+
+        TArray<float> Result(PixelNum);
+        for (int32 i = 0; i < PixelNum; ++i)
+        {
+            Result[i] = (Ranks[i] + 0.5f) / PixelNum;
+        }
+        return Result;
+    }();
+
+    return Mask;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "Math/Random.h"
+
+enum class ESamplerType
+{
+    Independent,
+    Sobol,
+    BlueNoiseSobol
+};
+
+// Produces the random numbers of one path sample. The integrator asks for dimensions in a fixed order
+// (camera, then per bounce: light, roulette, BSDF), so the same decision always reads the same dimension.
+class FSampler
+{
+public:
+    FSampler(uint32 InSeed) : Seed(InSeed) {}
+    virtual ~FSampler() = default;
+
+    static FSampler* Create(ESamplerType SamplerType, uint32 Seed, int32 ImageWidth);
+
+    // Begin the SampleIndex-th sample of pixel (X, Y) at the given dimension. Starting from a dimension returned by
+    // GetDimension continues that sample exactly, so many paths can be interleaved on one sampler.
+    virtual void StartPixelSample(int32 X, int32 Y, int32 SampleIndex, int32 Dimension = 0) = 0;
+
+    virtual float Get1D() = 0;
+    virtual FVector2 Get2D() = 0;
+
+    // Dimensions consumed so far: one per Get1D, two per Get2D.
+    virtual int32 GetDimension() const = 0;
+
+protected:
+    uint32 Seed;
+};
+
+// Uniform random numbers from a PCG32 stream keyed by pixel and sample index.
+class FIndependentSampler : public FSampler
+{
+public:
+    FIndependentSampler(uint32 InSeed, int32 InPixelStride) : FSampler(InSeed), PixelStride(InPixelStride) {}
+
+    virtual void StartPixelSample(int32 X, int32 Y, int32 SampleIndex, int32 InDimension = 0) override;
+
+    virtual float Get1D() override;
+    virtual FVector2 Get2D() override;
+
+    virtual int32 GetDimension() const override { return Dimension; }
+
+private:
+    int32 PixelStride;
+    int32 Dimension = 0;
+    FRandomStream RandomStream;
+};
+
+// Padded 2D Sobol (0,2)-sequence with hash-based Owen scrambling (Burley 2020, "Practical Hash-based Owen Scrambling").
+// Every 1D or 2D request is an independently shuffled and scrambled copy of the first Sobol dimensions,
+// so each decision is stratified over the samples of a pixel.
+class FSobolSampler : public FSampler
+{
+public:
+    FSobolSampler(uint32 InSeed) : FSampler(InSeed) {}
+
+    virtual void StartPixelSample(int32 X, int32 Y, int32 SampleIndex, int32 InDimension = 0) override;
+
+    virtual float Get1D() override;
+    virtual FVector2 Get2D() override;
+
+    virtual int32 GetDimension() const override { return Dimension; }
+
+protected:
+    virtual uint64 GetPixelHash(int32 X, int32 Y) const;
+    virtual float ApplyDither(float Value, int32 InDimension) const { return Value; }
+
+    static uint32 ReverseBits(uint32 Value);
+    static uint32 OwenScramble(uint32 Value, uint32 ScrambleSeed);
+
+protected:
+    int32 PixelX = 0;
+    int32 PixelY = 0;
+    uint32 SampleIndex = 0;
+    int32 Dimension = 0;
+    uint64 PixelHash = 0;
+};
+
+// Blue-noise dithered Sobol (Georgiev and Fajardo 2016, "Blue-noise Dithered Sampling").
+// All pixels share one scrambled sequence, and every dimension is toroidally shifted by a per-pixel blue-noise value.
+// The remaining error is spread as high-frequency noise that is far less visible at low sample counts.
+class FBlueNoiseSobolSampler : public FSobolSampler
+{
+public:
+    FBlueNoiseSobolSampler(uint32 InSeed) : FSobolSampler(InSeed) {}
+
+protected:
+    virtual uint64 GetPixelHash(int32 X, int32 Y) const override;
+    virtual float ApplyDither(float Value, int32 InDimension) const override;
+
+private:
+    static constexpr int32 MaskSize = 64;
+
+    // Void-and-cluster blue-noise ranks in [0, 1), generated once.
+    static const TArray<float>& GetBlueNoiseMask();
+};
@@ -0,0 +1,400 @@
+#include "Render/ImageWriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+
+// PFM and EXR store their fields little-endian, PNG big-endian.
+template <typename T>
+static void WriteValue(::std::ofstream& File, const T& Value)
+{
+    File.write(reinterpret_cast<const char*>(&Value), sizeof(T));
+}
+
+static void WriteBigEndian(TArray<uint8>& Out, uint32 Value)
+{
+    Out.emplace_back((uint8)(Value >> 24));
+    Out.emplace_back((uint8)(Value >> 16));
+    Out.emplace_back((uint8)(Value >> 8));
+    Out.emplace_back((uint8)Value);
+}
+
+// ********************
+//        PNG
+// ********************
+
+static uint32 GetCRC32(const uint8* Data, ::std::size_t Size, uint32 CRC = 0)
+{
+    static const TArray<uint32> Table = []()
+    {
+        TArray<uint32> Result(256);
+        for (uint32 Index = 0; Index < 256; ++Index)
+        {
+            uint32 Value = Index;
+            for (int32 Bit = 0; Bit < 8; ++Bit)
+            {
+                Value = (Value & 1) ? 0xEDB88320u ^ (Value >> 1) : Value >> 1;
+            }
+            Result[Index] = Value;
+        }
+        return Result;
+    }();
+
+    CRC = ~CRC;
+    for (::std::size_t Index = 0; Index < Size; ++Index)
+    {
+        CRC = Table[(CRC ^ Data[Index]) & 0xFF] ^ (CRC >> 8);
+    }
+    return ~CRC;
+}
+
+static void WritePNGChunk(::std::ofstream& File, const char* Type, const TArray<uint8>& Payload)
+{
+    TArray<uint8> Chunk;
+    WriteBigEndian(Chunk, (uint32)Payload.size());
+    Chunk.insert(Chunk.end(), Type, Type + 4);
+    Chunk.insert(Chunk.end(), Payload.begin(), Payload.end());
+    // The CRC covers the type and the payload.
+    WriteBigEndian(Chunk, GetCRC32(Chunk.data() + 4, Chunk.size() - 4));
+    File.write(reinterpret_cast<const char*>(Chunk.data()), (::std::streamsize)Chunk.size());
+}
+
+static void WritePNG(::std::ofstream& File, const uint8* RGB, int32 Width, int32 Height)
+{
+    static constexpr uint8 Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    File.write(reinterpret_cast<const char*>(Signature), sizeof(Signature));
+
+    TArray<uint8> Header;
+    WriteBigEndian(Header, (uint32)Width);
+    WriteBigEndian(Header, (uint32)Height);
+    // 8 bits per channel, RGB, deflate, adaptive filtering, no interlace.
+    Header.insert(Header.end(), {8, 2, 0, 0, 0});
+    WritePNGChunk(File, "IHDR", Header);
+
+    // Every row starts with its filter type, none here.
+    ::std::size_t RowSize = (::std::size_t)Width * 3;
+    TArray<uint8> Scanlines;
+    Scanlines.reserve((RowSize + 1) * Height);
+    for (int32 Row = 0; Row < Height; ++Row)
+    {
+        Scanlines.emplace_back(0);
+        Scanlines.insert(Scanlines.end(), RGB + Row * RowSize, RGB + (Row + 1) * RowSize);
+    }
+
+    // A zlib stream of stored blocks: no compression, so no zlib either. Files are as large as PPM, but open everywhere.
+    TArray<uint8> Stream = {0x78, 0x01};
+    uint32 A = 1, B = 0;
+    for (::std::size_t Offset = 0;; Offset += 65535)
+    {
+        uint32 BlockSize = (uint32)::std::min<::std::size_t>(65535, Scanlines.size() - Offset);
+        bool bFinal = Offset + BlockSize >= Scanlines.size();
+        Stream.insert(Stream.end(), {(uint8)(bFinal ? 1 : 0), (uint8)BlockSize, (uint8)(BlockSize >> 8), (uint8)~BlockSize,
+                                     (uint8)(~BlockSize >> 8)});
+        Stream.insert(Stream.end(), Scanlines.begin() + Offset, Scanlines.begin() + Offset + BlockSize);
+        for (uint32 Index = 0; Index < BlockSize; ++Index)
+        {
+            A = (A + Scanlines[Offset + Index]) % 65521;
+            B = (B + A) % 65521;
+        }
+        if (bFinal)
+        {
+            break;
+        }
+    }
+    WriteBigEndian(Stream, (B << 16) | A);
+    WritePNGChunk(File, "IDAT", Stream);
+    WritePNGChunk(File, "IEND", {});
+}
+
+// ********************
+//        EXR
+// ********************
+
+static void WriteEXRAttribute(::std::ofstream& File, const char* Name, const char* Type, const void* Value, int32 Size)
+{
+    File.write(Name, (::std::streamsize)strlen(Name) + 1);
+    File.write(Type, (::std::streamsize)strlen(Type) + 1);
+    WriteValue(File, Size);
+    File.write(reinterpret_cast<const char*>(Value), Size);
+}
+
+static void WriteEXR(::std::ofstream& File, const float* RGB, int32 Width, int32 Height)
+{
+    // Magic number and version 2, single part scanline file.
+    WriteValue(File, (int32)20000630);
+    WriteValue(File, (int32)2);
+
+    // Channels are listed alphabetically: B, G, R, each 32-bit float (type 2) sampled at every pixel.
+    TArray<uint8> Channels;
+    for (char Name : {'B', 'G', 'R'})
+    {
+        uint8 Channel[18] = {(uint8)Name, 0, 2, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0};
+        Channels.insert(Channels.end(), Channel, Channel + sizeof(Channel));
+    }
+    Channels.emplace_back(0);
+    WriteEXRAttribute(File, "channels", "chlist", Channels.data(), (int32)Channels.size());
+
+    uint8 Compression = 0;
+    uint8 LineOrder = 0;
+    int32 Window[4] = {0, 0, Width - 1, Height - 1};
+    float PixelAspectRatio = 1.0f;
+    float ScreenWindowCenter[2] = {0.0f, 0.0f};
+    float ScreenWindowWidth = 1.0f;
+    WriteEXRAttribute(File, "compression", "compression", &Compression, 1);
+    WriteEXRAttribute(File, "dataWindow", "box2i", Window, sizeof(Window));
+    WriteEXRAttribute(File, "displayWindow", "box2i", Window, sizeof(Window));
+    WriteEXRAttribute(File, "lineOrder", "lineOrder", &LineOrder, 1);
+    WriteEXRAttribute(File, "pixelAspectRatio", "float", &PixelAspectRatio, sizeof(float));
+    WriteEXRAttribute(File, "screenWindowCenter", "v2f", ScreenWindowCenter, sizeof(ScreenWindowCenter));
+    WriteEXRAttribute(File, "screenWindowWidth", "float", &ScreenWindowWidth, sizeof(float));
+    File.put(0);
+
+    // Offset table: where each scanline block starts. A block is its row, its size and then one run per channel.
+    int32 RowDataSize = Width * 3 * (int32)sizeof(float);
+    uint64 Offset = (uint64)File.tellp() + (uint64)Height * sizeof(uint64);
+    for (int32 Row = 0; Row < Height; ++Row)
+    {
+        WriteValue(File, Offset);
+        Offset += 2 * sizeof(int32) + RowDataSize;
+    }
+
+    TArray<float> RowData((::std::size_t)Width * 3);
+    for (int32 Row = 0; Row < Height; ++Row)
+    {
+        const float* Source = RGB + (::std::size_t)Row * Width * 3;
+        for (int32 Col = 0; Col < Width; ++Col)
+        {
+            RowData[Col] = Source[Col * 3 + 2];
+            RowData[Width + Col] = Source[Col * 3 + 1];
+            RowData[2 * Width + Col] = Source[Col * 3];
+        }
+        WriteValue(File, Row);
+        WriteValue(File, RowDataSize);
+        File.write(reinterpret_cast<const char*>(RowData.data()), RowDataSize);
+    }
+}
+
+// ********************
+//    Image writer
+// ********************
+
+bool FImageWriter::GetFormat(const FAString& FilePath, EImageFormat& OutFormat)
+{
+    ::std::size_t Dot = FilePath.find_last_of('.');
+    if (Dot == FAString::npos)
+    {
+        return false;
+    }
+
+    FAString Extension = FilePath.substr(Dot + 1);
+    ::std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](char C) { return (char)::std::tolower(C); });
+    if (Extension == "pfm")
+    {
+        OutFormat = EImageFormat::PFM;
+    }
+    else if (Extension == "exr")
+    {
+        OutFormat = EImageFormat::EXR;
+    }
+    else if (Extension == "png")
+    {
+        OutFormat = EImageFormat::PNG;
+    }
+    else if (Extension == "ppm")
+    {
+        OutFormat = EImageFormat::PPM;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool FImageWriter::Write(const FAString& FilePath, const FVector* Pixels, int32 Width, int32 Height,
+                         const FToneMapSettings& ToneMapSettings)
+{
+    EImageFormat Format;
+    if (!GetFormat(FilePath, Format))
+    {
+        return false;
+    }
+
+    ::std::size_t PixelNum = (::std::size_t)Width * Height;
+    if (Format == EImageFormat::PFM || Format == EImageFormat::EXR)
+    {
+        return WriteFloat(FilePath, Format, &Pixels[0].X, Width, Height);
+    }
+
+    TArray<FColor> Colors(PixelNum);
+    FToneMapper::Apply(ToneMapSettings, Pixels, Colors.data(), (int32)PixelNum);
+    return Write(FilePath, Colors.data(), Width, Height);
+}
+
+bool FImageWriter::Write(const FAString& FilePath, const FColor* Pixels, int32 Width, int32 Height)
+{
+    EImageFormat Format;
+    if (!GetFormat(FilePath, Format))
+    {
+        return false;
+    }
+
+    ::std::size_t PixelNum = (::std::size_t)Width * Height;
+    if (Format == EImageFormat::PFM || Format == EImageFormat::EXR)
+    {
+        TArray<float> RGB(PixelNum * 3);
+        for (::std::size_t Index = 0; Index < PixelNum; ++Index)
+        {
+            RGB[Index * 3] = FLinearColor::sRGBToLinearTable[Pixels[Index].B];
+            RGB[Index * 3 + 1] = FLinearColor::sRGBToLinearTable[Pixels[Index].G];
+            RGB[Index * 3 + 2] = FLinearColor::sRGBToLinearTable[Pixels[Index].R];
+        }
+        return WriteFloat(FilePath, Format, RGB.data(), Width, Height);
+    }
+
+    TArray<uint8> RGB(PixelNum * 3);
+    for (::std::size_t Index = 0; Index < PixelNum; ++Index)
+    {
+        RGB[Index * 3] = Pixels[Index].B;
+        RGB[Index * 3 + 1] = Pixels[Index].G;
+        RGB[Index * 3 + 2] = Pixels[Index].R;
+    }
+    return WriteByte(FilePath, Format, RGB.data(), Width, Height);
+}
+
+bool FImageWriter::WriteFloat(const FAString& FilePath, EImageFormat Format, const float* RGB, int32 Width, int32 Height)
+{
+    ::std::ofstream File(FilePath, ::std::ios::binary | ::std::ios::trunc);
+    if (!File)
+    {
+        return false;
+    }
+
+    if (Format == EImageFormat::EXR)
+    {
+        WriteEXR(File, RGB, Width, Height);
+    }
+    else
+    {
+        // A negative scale marks little-endian data. Rows go from bottom to top.
+        File << "PF\n" << Width << " " << Height << "\n-1.0\n";
+        ::std::size_t RowSize = (::std::size_t)Width * 3;
+        for (int32 Row = Height - 1; Row >= 0; --Row)
+        {
+            File.write(reinterpret_cast<const char*>(RGB + Row * RowSize), (::std::streamsize)(RowSize * sizeof(float)));
+        }
+    }
+    return (bool)File.flush();
+}
+
+bool FImageWriter::WriteByte(const FAString& FilePath, EImageFormat Format, const uint8* RGB, int32 Width, int32 Height)
+{
+    ::std::ofstream File(FilePath, ::std::ios::binary | ::std::ios::trunc);
+    if (!File)
+    {
+        return false;
+    }
+
+    if (Format == EImageFormat::PNG)
+    {
+        WritePNG(File, RGB, Width, Height);
+    }
+    else
+    {
+        File << "P6\n" << Width << " " << Height << "\n255\n";
+        File.write(reinterpret_cast<const char*>(RGB), (::std::streamsize)Width * Height * 3);
+    }
+    return (bool)File.flush();
+}
+
+// ********************
+// Async image writer
+// ********************
+
+FAsyncImageWriter::FAsyncImageWriter()
+{
+    Worker = ::std::thread(&FAsyncImageWriter::WriterThread, this);
+}
+
+FAsyncImageWriter::~FAsyncImageWriter()
+{
+    {
+        ::std::lock_guard<::std::mutex> Lock(Mutex);
+        bStopping = true;
+    }
+    JobCondition.notify_one();
+    Worker.join();
+}
+
+void FAsyncImageWriter::Write(const FAString& FilePath, const FVector* Pixels, int32 Width, int32 Height,
+                              const FToneMapSettings& ToneMapSettings)
+{
+    FJob Job;
+    Job.FilePath = FilePath;
+    Job.Width = Width;
+    Job.Height = Height;
+    Job.ToneMapSettings = ToneMapSettings;
+    Job.LinearPixels.assign(Pixels, Pixels + (::std::size_t)Width * Height);
+    Enqueue(::std::move(Job));
+}
+
+void FAsyncImageWriter::Write(const FAString& FilePath, const FColor* Pixels, int32 Width, int32 Height)
+{
+    FJob Job;
+    Job.FilePath = FilePath;
+    Job.Width = Width;
+    Job.Height = Height;
+    Job.ColorPixels.assign(Pixels, Pixels + (::std::size_t)Width * Height);
+    Enqueue(::std::move(Job));
+}
+
+bool FAsyncImageWriter::Flush()
+{
+    ::std::unique_lock<::std::mutex> Lock(Mutex);
+    IdleCondition.wait(Lock, [this]() { return Jobs.empty() && !bBusy; });
+    bool bSucceeded = !bFailed;
+    bFailed = false;
+    return bSucceeded;
+}
+
+void FAsyncImageWriter::Enqueue(FJob&& Job)
+{
+    {
+        ::std::lock_guard<::std::mutex> Lock(Mutex);
+        Jobs.emplace_back(::std::move(Job));
+    }
+    JobCondition.notify_one();
+}
+
+void FAsyncImageWriter::WriterThread()
+{
+    ::std::unique_lock<::std::mutex> Lock(Mutex);
+    while (true)
+    {
+        JobCondition.wait(Lock, [this]() { return bStopping || !Jobs.empty(); });
+        if (Jobs.empty())
+        {
+            // Stopping, and everything queued is written.
+            return;
+        }
+
+        FJob Job = ::std::move(Jobs.front());
+        Jobs.pop_front();
+        bBusy = true;
+        Lock.unlock();
+
+        bool bSucceeded = Job.ColorPixels.empty()
+                              ? FImageWriter::Write(Job.FilePath, Job.LinearPixels.data(), Job.Width, Job.Height, Job.ToneMapSettings)
+                              : FImageWriter::Write(Job.FilePath, Job.ColorPixels.data(), Job.Width, Job.Height);
+        if (!bSucceeded)
+        {
+            ::std::cout << "Failed to write image " << Job.FilePath << "\n";
+        }
+
+        Lock.lock();
+        bBusy = false;
+        bFailed = bFailed || !bSucceeded;
+        IdleCondition.notify_all();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "Render/ToneMapper.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+enum class EImageFormat
+{
+    // Linear float: Portable Float Map and uncompressed OpenEXR.
+    PFM,
+    EXR,
+    // 8-bit sRGB: PNG with stored (uncompressed) deflate blocks, and binary PPM.
+    PNG,
+    PPM
+};
+
+// Image files without OpenCV. Pixels are RGB, rows from top to bottom.
+class FImageWriter
+{
+public:
+    // The format follows the extension of FilePath: .pfm, .exr, .png or .ppm.
+    static bool GetFormat(const FAString& FilePath, EImageFormat& OutFormat);
+
+    // Linear radiance. The float formats store it as it is, the 8-bit ones tone map it with ToneMapSettings.
+    static bool Write(const FAString& FilePath, const FVector* Pixels, int32 Width, int32 Height,
+                      const FToneMapSettings& ToneMapSettings = FToneMapSettings());
+    // sRGB colors in the BGRA byte order of the rasterizer's render target. The float formats decode them to linear.
+    static bool Write(const FAString& FilePath, const FColor* Pixels, int32 Width, int32 Height);
+
+private:
+    static bool WriteFloat(const FAString& FilePath, EImageFormat Format, const float* RGB, int32 Width, int32 Height);
+    static bool WriteByte(const FAString& FilePath, EImageFormat Format, const uint8* RGB, int32 Width, int32 Height);
+};
+
+// Writes images on a worker thread, so rendering goes on while the file is encoded and written. Images are copied when
+// queued, the caller may change its buffer right away.
+class FAsyncImageWriter
+{
+public:
+    FAsyncImageWriter();
+    // Writes whatever is still queued.
+    ~FAsyncImageWriter();
+
+    void Write(const FAString& FilePath, const FVector* Pixels, int32 Width, int32 Height,
+               const FToneMapSettings& ToneMapSettings = FToneMapSettings());
+    void Write(const FAString& FilePath, const FColor* Pixels, int32 Width, int32 Height);
+
+    // Wait until every queued image is on disk. False if any of them failed since the last Flush.
+    bool Flush();
+
+private:
+    struct FJob
+    {
+        FAString FilePath;
+        int32 Width = 0;
+        int32 Height = 0;
+        FToneMapSettings ToneMapSettings;
+        // One of the two is filled.
+        TArray<FVector> LinearPixels;
+        TArray<FColor> ColorPixels;
+    };
+
+    void Enqueue(FJob&& Job);
+    void WriterThread();
+
+private:
+    ::std::thread Worker;
+    ::std::mutex Mutex;
+    // Signals new jobs to the worker, and finished ones to Flush.
+    ::std::condition_variable JobCondition;
+    ::std::condition_variable IdleCondition;
+    ::std::deque<FJob> Jobs;
+    bool bBusy = false;
+    bool bStopping = false;
+    bool bFailed = false;
+};
@@ -15,17 +15,9 @@ struct FVertexPrimitive
 
 struct FTrianglePrimitive
 {
-    union
-    {
-        struct
-        {
-            FVertexPrimitive A;
-            FVertexPrimitive B;
-            FVertexPrimitive C;
-        };
-
-        FVertexPrimitive Vertices[3];
-    };
+    FVertexPrimitive A;
+    FVertexPrimitive B;
+    FVertexPrimitive C;
 
     FTrianglePrimitive() {}
 
@@ -36,6 +36,7 @@ bool FRasterizationRenderer::Initialize(const FViewport& InViewport, const FCame
         Viewport = InViewport;
         ComputeViewportMatrix();
 
+        ColorBuffer.resize((std::size_t)(Viewport.Width * Viewport.Height));
         FrameBuffer.resize((std::size_t)(Viewport.Width * Viewport.Height));
         DepthBuffer.resize((std::size_t)(Viewport.Width * Viewport.Height));
 
@@ -117,7 +118,7 @@ void FRasterizationRenderer::UpdateProjectionMatrix()
 
 void FRasterizationRenderer::Clear()
 {
-    std::fill(FrameBuffer.begin(), FrameBuffer.end(), BackgroundColor);
+    std::fill(ColorBuffer.begin(), ColorBuffer.end(), FLinearColor(BackgroundColor));
     std::fill(DepthBuffer.begin(), DepthBuffer.end(), std::numeric_limits<float>::infinity());
 
     if (bMSAA && MSAAFactor != 0)
@@ -141,6 +142,9 @@ void FRasterizationRenderer::Render()
 
         RenderInternal(Mesh);
     }
+
+    // Convert to sRGB for display.
+    FToneMapper::Apply(ToneMapSettings, ColorBuffer.data(), FrameBuffer.data(), (int32)ColorBuffer.size());
 }
 
 void FRasterizationRenderer::RenderInternal(const FMesh* Mesh)
@@ -152,6 +156,7 @@ void FRasterizationRenderer::RenderInternal(const FMesh* Mesh)
     for (const FVector3i& TriangleIndex : Indices)
     {
         FTrianglePrimitive TrianglePrimitive;
+        FVertexPrimitive* TriangleVertices[3] = {&TrianglePrimitive.A, &TrianglePrimitive.B, &TrianglePrimitive.C};
 
         // Iterate through each vertex index to assemble the triangle primitive.
         for (int32 i = 0; i < 3; ++i)
@@ -165,7 +170,7 @@ void FRasterizationRenderer::RenderInternal(const FMesh* Mesh)
             VertexPrimitive.TexCoord = Vex.TexCoord;
             Shader->VertexShader(VertexPrimitive.VS_Position, VertexPrimitive.Position, VertexPrimitive.Normal);
 
-            TrianglePrimitive.Vertices[i] = VertexPrimitive;
+            *TriangleVertices[i] = VertexPrimitive;
         }
 
         // Pixel shading for each triangle.
@@ -195,85 +200,153 @@ void FRasterizationRenderer::RenderTriangle(const FTrianglePrimitive& TrianglePr
     int32 MinY = FMath::Clamp((int32)FMath::Floor(FMath::Min(VexA.Position.Y, VexB.Position.Y, VexC.Position.Y)), 0, Viewport.Height);
     int32 MaxY = FMath::Clamp((int32)FMath::Ceil(FMath::Max(VexA.Position.Y, VexB.Position.Y, VexC.Position.Y)), 0, Viewport.Height);
 
-    // Iterate over each pixel in the bouding box.
-    for (int32 X = MinX; X < MaxX; ++X)
+    // Iterate over the bounding box in 2x2 pixel quads, aligned to even coordinates.
+    for (int32 QuadX = MinX & ~1; QuadX < MaxX; QuadX += 2)
     {
-        for (int32 Y = MinY; Y < MaxY; ++Y)
+        for (int32 QuadY = MinY & ~1; QuadY < MaxY; QuadY += 2)
         {
-            int32 PixelIndex = GetPixelIndex(X, Y);
+            // Most quads of the bounding box miss a thin or diagonal triangle. Skip those before any interpolation.
+            if (!IsQuadCovered(QuadX, QuadY, MinX, MaxX, MinY, MaxY, TrianglePrimitive))
+            {
+                continue;
+            }
+
+            // Texture coordinates at all four pixel centers, also outside the triangle, so that every covered pixel has
+            // differences to its neighbours. The quad shares them, like the coarse derivatives of a GPU.
+            FVector2 QuadTexCoords[4];
+            for (int32 QuadIndex = 0; QuadIndex < 4; ++QuadIndex)
+            {
+                float U, V, W;
+                FTrianglePrimitive::GetTriangleBarycentric2D(
+                    QuadX + (QuadIndex & 1) + 0.5f, QuadY + (QuadIndex >> 1) + 0.5f, TrianglePrimitive, U, V, W);
+                float Reciprocal = 1.0f / (U + V + W);
+                QuadTexCoords[QuadIndex] = (U * VexA.TexCoord + V * VexB.TexCoord + W * VexC.TexCoord) * Reciprocal;
+            }
+            FVector2 TexCoordDX = QuadTexCoords[1] - QuadTexCoords[0];
+            FVector2 TexCoordDY = QuadTexCoords[2] - QuadTexCoords[0];
 
-            // Multi sample anti-aliasing.
-            if (bMSAA)
+            for (int32 QuadIndex = 0; QuadIndex < 4; ++QuadIndex)
             {
-                int32 ShadePoints = 0;
-                for (int32 OffsetIndex = 0; OffsetIndex < MSAAFactor; ++OffsetIndex)
+                int32 X = QuadX + (QuadIndex & 1);
+                int32 Y = QuadY + (QuadIndex >> 1);
+                if (X >= MinX && X < MaxX && Y >= MinY && Y < MaxY)
                 {
-                    float SampleX = X + MultiSampleOffsets[OffsetIndex].X;
-                    float SampleY = Y + MultiSampleOffsets[OffsetIndex].Y;
-
-                    if (FTrianglePrimitive::PointInsideTriangle(SampleX, SampleY, TrianglePrimitive))
-                    {
-                        float U, V, W;
-                        FTrianglePrimitive::GetTriangleBarycentric2D(SampleX, SampleY, TrianglePrimitive, U, V, W);
-                        float Reciprocal = 1.0f / (U + V + W);
-
-                        float InterpolatedZ = (U * VexA.Position.Z + V * VexB.Position.Z + W * VexC.Position.Z) * Reciprocal;
-                        if (InterpolatedZ < MSAADepthBuffer[PixelIndex * MSAAFactor + OffsetIndex])
-                        {
-                            MSAADepthBuffer[PixelIndex * MSAAFactor + OffsetIndex] = InterpolatedZ;
-                            ++ShadePoints;
-                        }
-                    }
+                    RenderPixel(X, Y, TrianglePrimitive, TexCoordDX, TexCoordDY, Texture);
                 }
+            }
+        }
+    }
+}
+
+bool FRasterizationRenderer::IsQuadCovered(int32 QuadX, int32 QuadY, int32 MinX, int32 MaxX, int32 MinY, int32 MaxY,
+                                           const FTrianglePrimitive& TrianglePrimitive) const
+{
+    for (int32 QuadIndex = 0; QuadIndex < 4; ++QuadIndex)
+    {
+        int32 X = QuadX + (QuadIndex & 1);
+        int32 Y = QuadY + (QuadIndex >> 1);
+        if (X < MinX || X >= MaxX || Y < MinY || Y >= MaxY)
+        {
+            continue;
+        }
 
-                if (ShadePoints > 0)
+        // With MSAA a pixel is shaded when any of its samples is covered, even if its center is not.
+        if (bMSAA)
+        {
+            for (int32 OffsetIndex = 0; OffsetIndex < MSAAFactor; ++OffsetIndex)
+            {
+                const FVector2& Offset = MultiSampleOffsets[OffsetIndex];
+                if (FTrianglePrimitive::PointInsideTriangle(X + Offset.X, Y + Offset.Y, TrianglePrimitive))
                 {
-                    float U, V, W;
-                    FTrianglePrimitive::GetTriangleBarycentric2D(X + 0.5f, Y + 0.5f, TrianglePrimitive, U, V, W);
-                    float Reciprocal = 1.0f / (U + V + W);
+                    return true;
+                }
+            }
+        }
+        else if (FTrianglePrimitive::PointInsideTriangle(X + 0.5f, Y + 0.5f, TrianglePrimitive))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-                    const FVector Normal = (U * VexA.Normal + V * VexB.Normal + W * VexC.Normal) * Reciprocal;
-                    const FVector2 TexCoord = (U * VexA.TexCoord + V * VexB.TexCoord + W * VexC.TexCoord) * Reciprocal;
-                    const FVector VS_Position = (U * VexA.VS_Position + V * VexB.VS_Position + W * VexC.VS_Position) * Reciprocal;
+void FRasterizationRenderer::RenderPixel(int32 X, int32 Y, const FTrianglePrimitive& TrianglePrimitive, const FVector2& TexCoordDX,
+                                         const FVector2& TexCoordDY, const FTexture* Texture)
+{
+    const FVertexPrimitive& VexA = TrianglePrimitive.A;
+    const FVertexPrimitive& VexB = TrianglePrimitive.B;
+    const FVertexPrimitive& VexC = TrianglePrimitive.C;
 
-                    FLinearColor PixelColor;
-                    Shader->PixelShader(PixelColor, VS_Position, Normal, TexCoord, Texture);
+    int32 PixelIndex = GetPixelIndex(X, Y);
 
-                    float CurrentColorRatio = (float)ShadePoints / MSAAFactor;
-                    PixelColor = CurrentColorRatio * PixelColor + (1 - CurrentColorRatio) * FrameBuffer[PixelIndex];
+    // Multi sample anti-aliasing.
+    if (bMSAA)
+    {
+        int32 ShadePoints = 0;
+        for (int32 OffsetIndex = 0; OffsetIndex < MSAAFactor; ++OffsetIndex)
+        {
+            float SampleX = X + MultiSampleOffsets[OffsetIndex].X;
+            float SampleY = Y + MultiSampleOffsets[OffsetIndex].Y;
 
-                    FrameBuffer[PixelIndex] = PixelColor.ToFColorSRGB();
-                }
-            }
-            // No anti-aliasing
-            else
+            if (FTrianglePrimitive::PointInsideTriangle(SampleX, SampleY, TrianglePrimitive))
             {
-                float SampleX = X + 0.5f;
-                float SampleY = Y + 0.5f;
+                float U, V, W;
+                FTrianglePrimitive::GetTriangleBarycentric2D(SampleX, SampleY, TrianglePrimitive, U, V, W);
+                float Reciprocal = 1.0f / (U + V + W);
 
-                // If the pixel is within triangle, the interpolation factor is calculated and the pixel is shaded.
-                if (FTrianglePrimitive::PointInsideTriangle(SampleX, SampleY, TrianglePrimitive))
+                float InterpolatedZ = (U * VexA.Position.Z + V * VexB.Position.Z + W * VexC.Position.Z) * Reciprocal;
+                if (InterpolatedZ < MSAADepthBuffer[PixelIndex * MSAAFactor + OffsetIndex])
                 {
-                    float U, V, W;
-                    FTrianglePrimitive::GetTriangleBarycentric2D(SampleX, SampleY, TrianglePrimitive, U, V, W);
-                    float Reciprocal = 1.0f / (U + V + W);
+                    MSAADepthBuffer[PixelIndex * MSAAFactor + OffsetIndex] = InterpolatedZ;
+                    ++ShadePoints;
+                }
+            }
+        }
 
-                    // Pixel shading is done if the current depth value is samller.
-                    float InterpolatedZ = (U * VexA.Position.Z + V * VexB.Position.Z + W * VexC.Position.Z) * Reciprocal;
-                    if (InterpolatedZ < DepthBuffer[PixelIndex])
-                    {
-                        DepthBuffer[PixelIndex] = InterpolatedZ;
+        if (ShadePoints > 0)
+        {
+            float U, V, W;
+            FTrianglePrimitive::GetTriangleBarycentric2D(X + 0.5f, Y + 0.5f, TrianglePrimitive, U, V, W);
+            float Reciprocal = 1.0f / (U + V + W);
 
-                        const FVector Normal = (U * VexA.Normal + V * VexB.Normal + W * VexC.Normal) * Reciprocal;
-                        const FVector2 TexCoord = (U * VexA.TexCoord + V * VexB.TexCoord + W * VexC.TexCoord) * Reciprocal;
-                        const FVector VS_Position = (U * VexA.VS_Position + V * VexB.VS_Position + W * VexC.VS_Position) * Reciprocal;
+            const FVector Normal = (U * VexA.Normal + V * VexB.Normal + W * VexC.Normal) * Reciprocal;
+            const FVector2 TexCoord = (U * VexA.TexCoord + V * VexB.TexCoord + W * VexC.TexCoord) * Reciprocal;
+            const FVector VS_Position = (U * VexA.VS_Position + V * VexB.VS_Position + W * VexC.VS_Position) * Reciprocal;
 
-                        FLinearColor PixelColor;
-                        Shader->PixelShader(PixelColor, VS_Position, Normal, TexCoord, Texture);
+            FLinearColor PixelColor;
+            Shader->PixelShader(PixelColor, VS_Position, Normal, TexCoord, TexCoordDX, TexCoordDY, Texture);
 
-                        FrameBuffer[PixelIndex] = PixelColor.ToFColorSRGB(); // Convert to sRGB for display.
-                    }
-                }
+            float CurrentColorRatio = (float)ShadePoints / MSAAFactor;
+            ColorBuffer[PixelIndex] = CurrentColorRatio * PixelColor + (1 - CurrentColorRatio) * ColorBuffer[PixelIndex];
+        }
+    }
+    // No anti-aliasing
+    else
+    {
+        float SampleX = X + 0.5f;
+        float SampleY = Y + 0.5f;
+
+        // If the pixel is within triangle, the interpolation factor is calculated and the pixel is shaded.
+        if (FTrianglePrimitive::PointInsideTriangle(SampleX, SampleY, TrianglePrimitive))
+        {
+            float U, V, W;
+            FTrianglePrimitive::GetTriangleBarycentric2D(SampleX, SampleY, TrianglePrimitive, U, V, W);
+            float Reciprocal = 1.0f / (U + V + W);
+
+            // Pixel shading is done if the current depth value is samller.
+            float InterpolatedZ = (U * VexA.Position.Z + V * VexB.Position.Z + W * VexC.Position.Z) * Reciprocal;
+            if (InterpolatedZ < DepthBuffer[PixelIndex])
+            {
+                DepthBuffer[PixelIndex] = InterpolatedZ;
+
+                const FVector Normal = (U * VexA.Normal + V * VexB.Normal + W * VexC.Normal) * Reciprocal;
+                const FVector2 TexCoord = (U * VexA.TexCoord + V * VexB.TexCoord + W * VexC.TexCoord) * Reciprocal;
+                const FVector VS_Position = (U * VexA.VS_Position + V * VexB.VS_Position + W * VexC.VS_Position) * Reciprocal;
+
+                FLinearColor PixelColor;
+                Shader->PixelShader(PixelColor, VS_Position, Normal, TexCoord, TexCoordDX, TexCoordDY, Texture);
+
+                ColorBuffer[PixelIndex] = PixelColor;
             }
         }
     }
@@ -327,6 +400,7 @@ void FRasterizationRenderer::ResetViewportSize(int32 InWidth, int32 InHeight)
     Viewport.Width = InWidth;
     Viewport.Height = InHeight;
 
+    ColorBuffer.resize((std::size_t)(InWidth * InHeight));
     FrameBuffer.resize((std::size_t)(InWidth * InHeight));
     DepthBuffer.resize((std::size_t)(InWidth * InHeight));
     if (bMSAA && MSAAFactor != 0)
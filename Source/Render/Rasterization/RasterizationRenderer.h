@@ -3,6 +3,7 @@
 #include "Render/Renderer.h"
 #include "Render/Camera.h"
 #include "Render/Rasterization/Shader.h"
+#include "Render/ToneMapper.h"
 
 struct FVertex;
 struct FTrianglePrimitive;
@@ -46,6 +47,11 @@ public:
 
     const FColor* GetRenderTarget() const { return FrameBuffer.data(); };
 
+    // Exposure and tone curve applied to the whole frame at the end of Render.
+    void SetToneMapSettings(const FToneMapSettings& InToneMapSettings) { ToneMapSettings = InToneMapSettings; }
+    // Texture filtering of the shader, after Initialize. Trilinear by default.
+    void SetTextureSampleMode(ETextureSampleMode TextureSampleMode) { Shader->SetTextureSampleMode(TextureSampleMode); }
+
     void ResetViewportSize(int32 InWidth, int32 InHeight);
     void SetCameraViewRadius(float DeltaRadius);
     void MoveCameraView(float DeltaAzimuthAngle, float DeltaZenithAngle);
@@ -58,6 +64,12 @@ private:
     void RenderInternal(const FMesh* Mesh);
 
     void RenderTriangle(const FTrianglePrimitive& TrianglePrimitive, const struct FTexture* Texture);
+    // Whether the triangle covers a sample of any pixel of the 2x2 quad at QuadX, QuadY that lies inside the bounding box.
+    bool IsQuadCovered(int32 QuadX, int32 QuadY, int32 MinX, int32 MaxX, int32 MinY, int32 MaxY,
+                       const FTrianglePrimitive& TrianglePrimitive) const;
+    // Depth test and shade one pixel of the triangle. TexCoordDX and TexCoordDY come from the pixel's 2x2 quad.
+    void RenderPixel(int32 X, int32 Y, const FTrianglePrimitive& TrianglePrimitive, const FVector2& TexCoordDX, const FVector2& TexCoordDY,
+                     const struct FTexture* Texture);
     // void RenderWireframe(const FTriangle& Triangle);
     // void DrawLine(const FVertex& Start, const FVertex& End);
 
@@ -77,9 +89,12 @@ private:
     // Scene meshes.
     TArray<FMesh*> Meshes;
 
-    // Render target buffer.
+    // Render target buffer. Fragments are shaded into the linear ColorBuffer, which is tone mapped into FrameBuffer once
+    // the frame is done.
     FColor BackgroundColor = FColor(0.f, 0.f, 0.f, 1.0f);
+    TArray<FLinearColor> ColorBuffer;
     TArray<FColor> FrameBuffer;
+    FToneMapSettings ToneMapSettings;
 
     // Z buffer.
     TArray<float> DepthBuffer;
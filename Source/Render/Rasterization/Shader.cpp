@@ -1,7 +1,5 @@
 #include "Render/Rasterization/Shader.h"
 
-#include "Material/Texture.h"
-
 void FShader::UploadViewPorjectionMatrix(const FMatrix4& InViewMatrix, const FMatrix4& InProjectionMatrix)
 {
     std::memcpy(&ViewMatrix, &InViewMatrix, 16 * sizeof(float));
@@ -31,6 +29,16 @@ void FShader::VertexShader(FVector& OutVSPosition, FVector& InOutPosition, FVect
     InOutNormal = (InvTransposeMVMatrix * FVector4(InOutNormal, 0.0f)).ToVector3().GetSafeNormal();
 }
 
+FLinearColor FShader::SampleTexture(
+    const FTexture* Texture, const FVector2& Texcoord, const FVector2& TexcoordDX, const FVector2& TexcoordDY) const
+{
+    if (TextureSampleMode == ETextureSampleMode::Trilinear)
+    {
+        return FTexureSampler::Sample(Texture, Texcoord, TexcoordDX, TexcoordDY, TextureSampleMode);
+    }
+    return FTexureSampler::Sample(Texture, Texcoord, TextureSampleMode);
+}
+
 FTextureMapShader::FTextureMapShader()
 {
     Lights.emplace_back(FLight(FVector{20, 20, 20}, FVector(500, 500, 500)));
@@ -38,9 +46,10 @@ FTextureMapShader::FTextureMapShader()
 }
 
 void FTextureMapShader::PixelShader(
-    FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord, const FTexture* Texture)
+    FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord, const FVector2& TexcoordDX,
+    const FVector2& TexcoordDY, const FTexture* Texture)
 {
-    FLinearColor TextureColor = FTexureSampler::Sample(Texture, Texcoord, ETextureSampleMode::Bilinear);
+    FLinearColor TextureColor = SampleTexture(Texture, Texcoord, TexcoordDX, TexcoordDY);
 
     FVector Ka = FVector(0.005f);
     FVector Kd = FVector(TextureColor.R, TextureColor.G, TextureColor.B);
@@ -80,7 +89,8 @@ FTextureNoLightShader::FTextureNoLightShader()
 }
 
 void FTextureNoLightShader::PixelShader(
-    FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord, const FTexture* Texture)
+    FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord, const FVector2& TexcoordDX,
+    const FVector2& TexcoordDY, const FTexture* Texture)
 {
-    OutPixelColor = FTexureSampler::Sample(Texture, Texcoord, ETextureSampleMode::Bilinear);
+    OutPixelColor = SampleTexture(Texture, Texcoord, TexcoordDX, TexcoordDY);
 }
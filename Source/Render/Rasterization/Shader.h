@@ -2,8 +2,7 @@
 
 #include "CoreTypes.h"
 #include "Render/Light.h"
-
-struct FTexture;
+#include "Material/Texture.h"
 
 enum class EShaderType
 {
@@ -23,8 +22,16 @@ public:
     void UploadViewportMatrix(const FMatrix4& InViewportMatrix);
 
     virtual void VertexShader(FVector& OutVSPosition, FVector& InOutPosition, FVector& InOutNormal);
+    // TexcoordDX and TexcoordDY are the changes of Texcoord to the next pixel right and up, from the pixel's 2x2 quad.
     virtual void PixelShader(FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord,
-        const FTexture* Texture) = 0;
+        const FVector2& TexcoordDX, const FVector2& TexcoordDY, const FTexture* Texture) = 0;
+
+    // Filtering of the pixel shaders' texture reads. Trilinear uses the quad derivatives, Nearest and Bilinear read level 0.
+    void SetTextureSampleMode(ETextureSampleMode InTextureSampleMode) { TextureSampleMode = InTextureSampleMode; }
+
+protected:
+    FLinearColor SampleTexture(
+        const FTexture* Texture, const FVector2& Texcoord, const FVector2& TexcoordDX, const FVector2& TexcoordDY) const;
 
 protected:
     FMatrix4 ModelMatrix;
@@ -39,6 +46,8 @@ protected:
 
     FVector EyePosition = FVector(0.f, 0.f, 5.f);
     TArray<FLight> Lights;
+
+    ETextureSampleMode TextureSampleMode = ETextureSampleMode::Trilinear;
 };
 
 class FTextureMapShader : public FShader
@@ -47,7 +56,7 @@ public:
     FTextureMapShader();
 
     virtual void PixelShader(FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord,
-        const FTexture* Texture) override;
+        const FVector2& TexcoordDX, const FVector2& TexcoordDY, const FTexture* Texture) override;
 };
 
 class FTextureNoLightShader : public FShader
@@ -56,5 +65,5 @@ public:
     FTextureNoLightShader();
 
     virtual void PixelShader(FLinearColor& OutPixelColor, const FVector& VS_Position, const FVector& Normal, const FVector2& Texcoord,
-        const FTexture* Texture) override;
+        const FVector2& TexcoordDX, const FVector2& TexcoordDY, const FTexture* Texture) override;
 };
@@ -0,0 +1,78 @@
+#include "Render/Rasterization/TextureCacheTest.h"
+#include "Render/Rasterization/RasterizationRenderer.h"
+#include "Material/TextureCacheSimulator.h"
+#include "Geometry/Mesh.h"
+
+#include <iomanip>
+
+TArray<FTextureCacheSample> FTextureCacheTest::Run(FRasterizationRenderer* Renderer, FMesh* Mesh, const FString& TexturePath,
+    const TArray<ETextureLayout>& Layouts, const TArray<ETextureSampleMode>& SampleModes, const TArray<FTextureCacheView>& Views)
+{
+    TArray<FTextureCacheSample> Samples;
+    for (ETextureLayout Layout : Layouts)
+    {
+        FTexture Texture(TexturePath, Layout);
+        Mesh->SetTexture(&Texture);
+
+        for (ETextureSampleMode SampleMode : SampleModes)
+        {
+            Renderer->SetTextureSampleMode(SampleMode);
+            for (const FTextureCacheView& View : Views)
+            {
+                Mesh->SetTransform(FVector::ZeroVector, View.Rotation, FVector(View.Scale));
+                Renderer->Clear();
+
+                FTextureCacheSimulator::Reset();
+                Renderer->Render();
+
+                FTextureCacheSample Sample = {Layout, SampleMode, View, FTextureCacheSimulator::GetSampleNum(),
+                    FTextureCacheSimulator::GetMissNum(), FTextureCacheSimulator::GetLineNum()};
+                Samples.emplace_back(Sample);
+            }
+        }
+        Mesh->SetTexture(nullptr);
+    }
+    Renderer->SetTextureSampleMode(ETextureSampleMode::Trilinear);
+
+    std::cout << "Layout, SampleMode, Scale, Rotation, Samples, Misses/Sample, Lines\n";
+    for (const FTextureCacheSample& Sample : Samples)
+    {
+        const FVector& Rotation = Sample.View.Rotation;
+        double MissesPerSample = Sample.SampleNum > 0 ? (double)Sample.MissNum / Sample.SampleNum : 0.0;
+        std::cout << GetLayoutName(Sample.Layout) << ", " << GetSampleModeName(Sample.SampleMode) << ", " << std::fixed
+                  << std::setprecision(2) << Sample.View.Scale << ", " << std::setprecision(0) << Rotation.X << " " << Rotation.Y << " "
+                  << Rotation.Z << ", " << Sample.SampleNum << ", " << std::setprecision(3) << MissesPerSample << ", " << Sample.LineNum
+                  << "\n";
+    }
+    std::cout.flush();
+
+    return Samples;
+}
+
+const char* FTextureCacheTest::GetLayoutName(ETextureLayout Layout)
+{
+    switch (Layout)
+    {
+    case ETextureLayout::Linear:
+        return "Linear";
+    case ETextureLayout::Tiled:
+        return "Tiled";
+    default:
+        return "Unknown";
+    }
+}
+
+const char* FTextureCacheTest::GetSampleModeName(ETextureSampleMode SampleMode)
+{
+    switch (SampleMode)
+    {
+    case ETextureSampleMode::Nearest:
+        return "Nearest";
+    case ETextureSampleMode::Bilinear:
+        return "Bilinear";
+    case ETextureSampleMode::Trilinear:
+        return "Trilinear";
+    default:
+        return "Unknown";
+    }
+}
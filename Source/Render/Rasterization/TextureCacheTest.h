@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "Material/Texture.h"
+
+class FRasterizationRenderer;
+class FMesh;
+
+struct FTextureCacheView
+{
+    float Scale;
+    FVector Rotation;
+};
+
+struct FTextureCacheSample
+{
+    ETextureLayout Layout;
+    ETextureSampleMode SampleMode;
+    FTextureCacheView View;
+    int64 SampleNum;
+    int64 MissNum;
+    int64 LineNum;
+};
+
+// Compares texture layouts and filters by the cache traffic of their texel reads, counted by FTextureCacheSimulator.
+// Needs a SOFT_TEXTURE_CACHE_TEST build, elsewhere every count is zero.
+class FTextureCacheTest
+{
+public:
+    // Load the texture in every layout and render one frame of the mesh per sample mode and view, from a cold cache.
+    // Prints one line per frame.
+    static TArray<FTextureCacheSample> Run(FRasterizationRenderer* Renderer, FMesh* Mesh, const FString& TexturePath,
+        const TArray<ETextureLayout>& Layouts, const TArray<ETextureSampleMode>& SampleModes, const TArray<FTextureCacheView>& Views);
+
+private:
+    static const char* GetLayoutName(ETextureLayout Layout);
+    static const char* GetSampleModeName(ETextureSampleMode SampleMode);
+};
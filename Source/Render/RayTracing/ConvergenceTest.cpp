@@ -0,0 +1,69 @@
+#include "Render/RayTracing/ConvergenceTest.h"
+#include "Render/RayTracing/RayTracingRenderer.h"
+
+#include <chrono>
+#include <iomanip>
+
+TArray<FConvergenceSample> FConvergenceTest::Run(
+    FRayTracingRenderer* Renderer, const TArray<ESamplerType>& SamplerTypes, const TArray<int32>& SPPs, int32 ReferenceSPP)
+{
+    int32 PixelNum = Renderer->GetWidth() * Renderer->GetHeight();
+
+    // The reference uses a different seed, so its own noise is uncorrelated with the images it is compared to.
+    Renderer->SetSamplerType(ESamplerType::Sobol);
+    Renderer->SetRandomSeed(0x9e3779b9u);
+    Renderer->RenderImage(ReferenceSPP);
+    TArray<FVector> Reference(Renderer->GetFrameBuffer(), Renderer->GetFrameBuffer() + PixelNum);
+    Renderer->SetRandomSeed(0);
+
+    TArray<FConvergenceSample> Samples;
+    for (ESamplerType SamplerType : SamplerTypes)
+    {
+        Renderer->SetSamplerType(SamplerType);
+        for (int32 SPP : SPPs)
+        {
+            auto Begin = std::chrono::steady_clock::now();
+            Renderer->RenderImage(SPP);
+            double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+
+            FConvergenceSample Sample = {SamplerType, SPP, Seconds, RMSE(Renderer->GetFrameBuffer(), Reference.data(), PixelNum)};
+            Samples.emplace_back(Sample);
+        }
+    }
+
+    std::cout << "Sampler, SPP, Seconds, RMSE\n";
+    for (const FConvergenceSample& Sample : Samples)
+    {
+        std::cout << GetSamplerName(Sample.SamplerType) << ", " << Sample.SPP << ", " << std::fixed << std::setprecision(3)
+                  << Sample.Seconds << ", " << std::setprecision(6) << Sample.RMSE << "\n";
+    }
+    std::cout.flush();
+
+    return Samples;
+}
+
+float FConvergenceTest::RMSE(const FVector* Image, const FVector* Reference, int32 PixelNum)
+{
+    double SquaredError = 0.0;
+    for (int32 i = 0; i < PixelNum; ++i)
+    {
+        FVector Diff = Image[i] - Reference[i];
+        SquaredError += Diff.SquaredLength();
+    }
+    return (float)FMath::Sqrt(SquaredError / (3.0 * PixelNum));
+}
+
+const char* FConvergenceTest::GetSamplerName(ESamplerType SamplerType)
+{
+    switch (SamplerType)
+    {
+    case ESamplerType::Independent:
+        return "Independent";
+    case ESamplerType::Sobol:
+        return "Sobol";
+    case ESamplerType::BlueNoiseSobol:
+        return "BlueNoiseSobol";
+    default:
+        return "Unknown";
+    }
+}
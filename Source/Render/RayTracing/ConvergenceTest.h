@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "RayTracing/Sampler.h"
+
+class FRayTracingRenderer;
+
+struct FConvergenceSample
+{
+    ESamplerType SamplerType;
+    int32 SPP;
+    double Seconds;
+    float RMSE;
+};
+
+// Compares samplers by RMSE against a high-SPP reference, as a function of render time.
+class FConvergenceTest
+{
+public:
+    // Render the reference with ReferenceSPP once, then every sampler at every SPP. Prints one line per render.
+    static TArray<FConvergenceSample> Run(FRayTracingRenderer* Renderer, const TArray<ESamplerType>& SamplerTypes,
+        const TArray<int32>& SPPs, int32 ReferenceSPP);
+
+    static float RMSE(const FVector* Image, const FVector* Reference, int32 PixelNum);
+
+private:
+    static const char* GetSamplerName(ESamplerType SamplerType);
+};
@@ -0,0 +1,186 @@
+#include "Render/RayTracing/Denoiser.h"
+
+#include <cmath>
+#include <thread>
+
+// B3-spline weights of the a-trous kernel along one axis.
+static constexpr float KernelWeights[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+// Albedo below this is treated as black, so demodulation does not blow up the noise of dark surfaces.
+static constexpr float MinAlbedo = 0.01f;
+
+static FORCEINLINE float GetLuminance(float R, float G, float B)
+{
+    return 0.2126f * R + 0.7152f * G + 0.0722f * B;
+}
+
+FDenoiser::FDenoiser(int32 InWidth, int32 InHeight) : Width(InWidth), Height(InHeight)
+{
+    ::std::size_t PixelNum = (::std::size_t)(Width * Height);
+    for (int32 Channel = 0; Channel < 3; ++Channel)
+    {
+        Irradiance[Channel].resize(PixelNum);
+        FilteredIrradiance[Channel].resize(PixelNum);
+        Normal[Channel].resize(PixelNum);
+    }
+    IrradianceVariance.resize(PixelNum);
+    FilteredIrradianceVariance.resize(PixelNum);
+    Depth.resize(PixelNum);
+}
+
+void FDenoiser::Denoise(const FVector* Color, const float* Variance, const FSurfaceFeatures* Features, FVector* OutColor, int32 ThreadCount)
+{
+    int32 PixelNum = Width * Height;
+
+    // Demodulate the albedo and split everything into planes.
+    for (int32 PixelIndex = 0; PixelIndex < PixelNum; ++PixelIndex)
+    {
+        const FSurfaceFeatures& Feature = Features[PixelIndex];
+        Irradiance[0][PixelIndex] = Feature.Albedo.X > MinAlbedo ? Color[PixelIndex].X / Feature.Albedo.X : Color[PixelIndex].X;
+        Irradiance[1][PixelIndex] = Feature.Albedo.Y > MinAlbedo ? Color[PixelIndex].Y / Feature.Albedo.Y : Color[PixelIndex].Y;
+        Irradiance[2][PixelIndex] = Feature.Albedo.Z > MinAlbedo ? Color[PixelIndex].Z / Feature.Albedo.Z : Color[PixelIndex].Z;
+        float AlbedoLuminance = GetLuminance(Feature.Albedo.X, Feature.Albedo.Y, Feature.Albedo.Z);
+        float AlbedoScale = AlbedoLuminance > MinAlbedo ? 1.0f / AlbedoLuminance : 1.0f;
+        IrradianceVariance[PixelIndex] = Variance[PixelIndex] * AlbedoScale * AlbedoScale;
+        Normal[0][PixelIndex] = Feature.Normal.X;
+        Normal[1][PixelIndex] = Feature.Normal.Y;
+        Normal[2][PixelIndex] = Feature.Normal.Z;
+        Depth[PixelIndex] = Feature.Depth;
+    }
+
+    ThreadCount = FMath::Max(ThreadCount, 1);
+    int32 OneThreadRows = Height / ThreadCount + 1;
+
+    for (int32 Iteration = 0; Iteration < Settings.Iterations; ++Iteration)
+    {
+        int32 Step = 1 << Iteration;
+
+        TArray<::std::thread> Workers;
+        for (int32 i = 0; i < ThreadCount; ++i)
+        {
+            int32 BeginRow = i * OneThreadRows;
+            int32 EndRow = FMath::Min(BeginRow + OneThreadRows, Height);
+            if (BeginRow < EndRow)
+            {
+                Workers.emplace_back(::std::thread(&FDenoiser::FilterRows, this, BeginRow, EndRow, Step));
+            }
+        }
+
+        for (::std::thread& Worker : Workers)
+        {
+            Worker.join();
+        }
+
+        for (int32 Channel = 0; Channel < 3; ++Channel)
+        {
+            Irradiance[Channel].swap(FilteredIrradiance[Channel]);
+        }
+        IrradianceVariance.swap(FilteredIrradianceVariance);
+    }
+
+    // Modulate the albedo back in.
+    for (int32 PixelIndex = 0; PixelIndex < PixelNum; ++PixelIndex)
+    {
+        const FVector& Albedo = Features[PixelIndex].Albedo;
+        OutColor[PixelIndex].X = Albedo.X > MinAlbedo ? Irradiance[0][PixelIndex] * Albedo.X : Irradiance[0][PixelIndex];
+        OutColor[PixelIndex].Y = Albedo.Y > MinAlbedo ? Irradiance[1][PixelIndex] * Albedo.Y : Irradiance[1][PixelIndex];
+        OutColor[PixelIndex].Z = Albedo.Z > MinAlbedo ? Irradiance[2][PixelIndex] * Albedo.Z : Irradiance[2][PixelIndex];
+    }
+}
+
+void FDenoiser::FilterRows(int32 BeginRow, int32 EndRow, int32 Step)
+{
+    float InvNormalSigma2 = 1.0f / (Settings.NormalSigma * Settings.NormalSigma);
+    float DepthScale = Settings.DepthSigma * Step;
+
+    // Weighted sums of one row, accumulated tap by tap, and the luminance scale of every center pixel.
+    TArray<float> Sums((::std::size_t)(Width * 5));
+    TArray<float> InvLuminanceScale((::std::size_t)Width);
+    float* SumR = Sums.data();
+    float* SumG = SumR + Width;
+    float* SumB = SumG + Width;
+    float* SumW = SumB + Width;
+    float* SumVariance = SumW + Width;
+
+    for (int32 Row = BeginRow; Row < EndRow; ++Row)
+    {
+        ::std::fill(Sums.begin(), Sums.end(), 0.0f);
+
+        int32 RowOffset = Row * Width;
+        const float* PR = Irradiance[0].data() + RowOffset;
+        const float* PG = Irradiance[1].data() + RowOffset;
+        const float* PB = Irradiance[2].data() + RowOffset;
+        const float* PVariance = IrradianceVariance.data() + RowOffset;
+        const float* PNX = Normal[0].data() + RowOffset;
+        const float* PNY = Normal[1].data() + RowOffset;
+        const float* PNZ = Normal[2].data() + RowOffset;
+        const float* PZ = Depth.data() + RowOffset;
+
+        for (int32 Col = 0; Col < Width; ++Col)
+        {
+            InvLuminanceScale[Col] = 1.0f / (Settings.LuminanceSigma * ::std::sqrt(PVariance[Col]) + KINDA_SMALL_NUMBER);
+        }
+
+        for (int32 KY = 0; KY < 5; ++KY)
+        {
+            int32 TapRow = Row + (KY - 2) * Step;
+            if (TapRow < 0 || TapRow >= Height)
+            {
+                continue;
+            }
+
+            for (int32 KX = 0; KX < 5; ++KX)
+            {
+                // Only the columns whose tap lies inside the image. Missing taps are covered by the normalization.
+                int32 Offset = (KX - 2) * Step;
+                int32 BeginCol = FMath::Max(0, -Offset);
+                int32 EndCol = FMath::Min(Width, Width - Offset);
+
+                int32 TapOffset = TapRow * Width + Offset;
+                const float* QR = Irradiance[0].data() + TapOffset;
+                const float* QG = Irradiance[1].data() + TapOffset;
+                const float* QB = Irradiance[2].data() + TapOffset;
+                const float* QVariance = IrradianceVariance.data() + TapOffset;
+                const float* QNX = Normal[0].data() + TapOffset;
+                const float* QNY = Normal[1].data() + TapOffset;
+                const float* QNZ = Normal[2].data() + TapOffset;
+                const float* QZ = Depth.data() + TapOffset;
+
+                float Kernel = KernelWeights[KY] * KernelWeights[KX];
+                for (int32 Col = BeginCol; Col < EndCol; ++Col)
+                {
+                    float DL = GetLuminance(QR[Col], QG[Col], QB[Col]) - GetLuminance(PR[Col], PG[Col], PB[Col]);
+                    float DNX = QNX[Col] - PNX[Col];
+                    float DNY = QNY[Col] - PNY[Col];
+                    float DNZ = QNZ[Col] - PNZ[Col];
+                    float DZ = ::std::fabs(QZ[Col] - PZ[Col]);
+
+                    float Exponent = ::std::fabs(DL) * InvLuminanceScale[Col];
+                    Exponent += (DNX * DNX + DNY * DNY + DNZ * DNZ) * InvNormalSigma2;
+                    Exponent += DZ / (DepthScale * PZ[Col] + SMALL_NUMBER);
+                    float Weight = Kernel * ::std::exp(-Exponent);
+
+                    SumR[Col] += Weight * QR[Col];
+                    SumG[Col] += Weight * QG[Col];
+                    SumB[Col] += Weight * QB[Col];
+                    SumW[Col] += Weight;
+                    SumVariance[Col] += Weight * Weight * QVariance[Col];
+                }
+            }
+        }
+
+        // The center tap always has a positive weight.
+        float* OutR = FilteredIrradiance[0].data() + RowOffset;
+        float* OutG = FilteredIrradiance[1].data() + RowOffset;
+        float* OutB = FilteredIrradiance[2].data() + RowOffset;
+        float* OutVariance = FilteredIrradianceVariance.data() + RowOffset;
+        for (int32 Col = 0; Col < Width; ++Col)
+        {
+            float InvWeight = 1.0f / SumW[Col];
+            OutR[Col] = SumR[Col] * InvWeight;
+            OutG[Col] = SumG[Col] * InvWeight;
+            OutB[Col] = SumB[Col] * InvWeight;
+            OutVariance[Col] = SumVariance[Col] * InvWeight * InvWeight;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+// First-hit surface attributes of a pixel, averaged over its samples. Misses keep all zeros.
+struct FSurfaceFeatures
+{
+    FVector Albedo = FVector::ZeroVector;
+    FVector Normal = FVector::ZeroVector;
+    float Depth = 0.0f;
+};
+
+struct FDenoiserSettings
+{
+    int32 Iterations = 5;
+
+    // Edge-stopping strengths. Smaller values preserve more edges and remove less noise.
+    // Luminance differences are measured in standard deviations of the center pixel's estimate.
+    float LuminanceSigma = 4.0f;
+    float NormalSigma = 0.3f;
+    // Relative to the depth of the center pixel and to the step width.
+    float DepthSigma = 0.01f;
+};
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010, "Edge-Avoiding A-Trous Wavelet Transform for fast Global
+// Illumination Filtering"). The color is divided by the albedo first, so textures and material edges are not blurred, and
+// is filtered with a 5x5 B3-spline kernel whose taps are 2^i pixels apart in iteration i.
+// As in SVGF (Schied et al. 2017), the luminance edge-stopping function is scaled by the standard deviation of each pixel's
+// estimate, and that variance is filtered along, so strong noise is smoothed while real edges survive.
+// Weights are computed on planar float rows, so the inner loops run over contiguous memory without branches.
+class FDenoiser
+{
+public:
+    FDenoiser(int32 InWidth, int32 InHeight);
+
+    void SetSettings(const FDenoiserSettings& InSettings) { Settings = InSettings; }
+    const FDenoiserSettings& GetSettings() const { return Settings; }
+
+    // All buffers hold Width * Height pixels. Variance is the variance of each pixel's mean luminance.
+    // OutColor may alias Color.
+    void Denoise(const FVector* Color, const float* Variance, const FSurfaceFeatures* Features, FVector* OutColor, int32 ThreadCount);
+
+private:
+    void FilterRows(int32 BeginRow, int32 EndRow, int32 Step);
+
+private:
+    int32 Width;
+    int32 Height;
+    FDenoiserSettings Settings;
+
+    // Planar buffers: the irradiance and its variance being filtered (ping-ponged between iterations) and the guide features.
+    TArray<float> Irradiance[3];
+    TArray<float> FilteredIrradiance[3];
+    TArray<float> IrradianceVariance;
+    TArray<float> FilteredIrradianceVariance;
+    TArray<float> Normal[3];
+    TArray<float> Depth;
+};
@@ -0,0 +1,134 @@
+#include "Render/RayTracing/EnvironmentLight.h"
+#include "Math/Random.h"
+
+#pragma warning(disable : 4819)
+#include <opencv2/opencv.hpp>
+#pragma warning(default : 4819)
+
+#include <cstring>
+
+FEnvironmentLight::FEnvironmentLight(const FString& Path, float InIntensity) : Intensity(InIntensity)
+{
+    cv::Mat Image = cv::imread(FStringUtils::ToAString(Path), cv::IMREAD_ANYDEPTH | cv::IMREAD_COLOR);
+    if (Image.empty())
+    {
+        return;
+    }
+
+    Width = Image.cols;
+    Height = Image.rows;
+    Radiance.resize((::std::size_t)(Width * Height));
+    if (Image.depth() == CV_8U)
+    {
+        for (int32 Row = 0; Row < Height; ++Row)
+        {
+            for (int32 Col = 0; Col < Width; ++Col)
+            {
+                const cv::Vec3b& Texel = Image.at<cv::Vec3b>(Row, Col);
+                FLinearColor Color = FLinearColor(FColor(Texel[2], Texel[1], Texel[0]));
+                Radiance[Row * Width + Col] = FVector(Color.R, Color.G, Color.B);
+            }
+        }
+    }
+    else
+    {
+        Image.convertTo(Image, CV_32FC3);
+        for (int32 Row = 0; Row < Height; ++Row)
+        {
+            for (int32 Col = 0; Col < Width; ++Col)
+            {
+                const cv::Vec3f& Texel = Image.at<cv::Vec3f>(Row, Col);
+                Radiance[Row * Width + Col] = FVector(Texel[2], Texel[1], Texel[0]);
+            }
+        }
+    }
+
+    BuildDistribution();
+}
+
+FEnvironmentLight::FEnvironmentLight(int32 InWidth, int32 InHeight, const TArray<FVector>& InRadiance, float InIntensity)
+    : Width(InWidth), Height(InHeight), Radiance(InRadiance), Intensity(InIntensity)
+{
+    BuildDistribution();
+}
+
+void FEnvironmentLight::BuildDistribution()
+{
+    // Texels near the poles cover less solid angle: weight them by sin(theta) at their center.
+    TArray<float> Weights((::std::size_t)(Width * Height));
+    for (int32 Row = 0; Row < Height; ++Row)
+    {
+        float SinTheta = FMath::Sin(PI * (Row + 0.5f) / Height);
+        for (int32 Col = 0; Col < Width; ++Col)
+        {
+            const FVector& Texel = Radiance[Row * Width + Col];
+            float Luminance = 0.2126f * Texel.X + 0.7152f * Texel.Y + 0.0722f * Texel.Z;
+            Weights[Row * Width + Col] = FMath::Max(Luminance, 0.0f) * SinTheta;
+        }
+    }
+    Distribution = FDistribution2D(Weights.data(), Width, Height);
+
+    uint32 IntensityBits;
+    ::std::memcpy(&IntensityBits, &Intensity, sizeof(float));
+    Checksum = FRandomStream::MixBits(((uint64)(uint32)Height << 32 | (uint32)Width) ^ IntensityBits);
+    for (const FVector& Texel : Radiance)
+    {
+        uint32 TexelBits[3];
+        ::std::memcpy(TexelBits, &Texel.X, sizeof(float));
+        ::std::memcpy(TexelBits + 1, &Texel.Y, sizeof(float));
+        ::std::memcpy(TexelBits + 2, &Texel.Z, sizeof(float));
+        Checksum = FRandomStream::MixBits(Checksum ^ (TexelBits[0] | (uint64)TexelBits[1] << 32));
+        Checksum = FRandomStream::MixBits(Checksum ^ TexelBits[2]);
+    }
+}
+
+FVector FEnvironmentLight::ToDirection(const FVector2& Point)
+{
+    float Theta = Point.Y * PI;
+    float Phi = Point.X * 2.0f * PI;
+    float SinTheta = FMath::Sin(Theta);
+    return FVector(SinTheta * FMath::Cos(Phi), FMath::Cos(Theta), SinTheta * FMath::Sin(Phi));
+}
+
+FVector2 FEnvironmentLight::ToPoint(const FVector& Direction)
+{
+    float Theta = FMath::Acos(Direction.Y);
+    float Phi = FMath::Atan2(Direction.Z, Direction.X);
+    if (Phi < 0.0f)
+    {
+        Phi += 2.0f * PI;
+    }
+    return FVector2(Phi * (0.5f * PI_INV), Theta * PI_INV);
+}
+
+FVector FEnvironmentLight::Lookup(const FVector2& Point) const
+{
+    // Nearest texel, so the radiance is piecewise constant just like the sampling density.
+    int32 Col = FMath::Clamp((int32)(Point.X * Width), 0, Width - 1);
+    int32 Row = FMath::Clamp((int32)(Point.Y * Height), 0, Height - 1);
+    return Radiance[Row * Width + Col] * Intensity;
+}
+
+FVector FEnvironmentLight::Evaluate(const FVector& Direction) const
+{
+    return Width > 0 ? Lookup(ToPoint(Direction)) : FVector::ZeroVector;
+}
+
+FVector FEnvironmentLight::Sample(const FVector2& U, FVector& OutDirection, float& OutPDF) const
+{
+    float PointPDF = 0.0f;
+    FVector2 Point = Distribution.SampleContinuous(U, &PointPDF);
+    OutDirection = ToDirection(Point);
+
+    // The map covers 2 * PI by PI radians, and a unit of area at latitude theta covers sin(theta) of solid angle.
+    float SinTheta = FMath::Sin(Point.Y * PI);
+    OutPDF = SinTheta > 0.0f ? PointPDF / (2.0f * PI * PI * SinTheta) : 0.0f;
+    return Lookup(Point);
+}
+
+float FEnvironmentLight::PDF(const FVector& Direction) const
+{
+    FVector2 Point = ToPoint(Direction);
+    float SinTheta = FMath::Sin(Point.Y * PI);
+    return SinTheta > 0.0f ? Distribution.PDF(Point) / (2.0f * PI * PI * SinTheta) : 0.0f;
+}
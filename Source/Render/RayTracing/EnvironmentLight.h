@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "Math/Distribution.h"
+
+// Light arriving from infinitely far away, stored as an equirectangular (latitude-longitude) radiance map with +Y up:
+// rows go from +Y down to -Y, columns around Y starting at +X.
+// Directions are importance sampled by a piecewise-constant distribution over the texels, weighted by their luminance
+// and by the solid angle they cover, so a bright sun or window gets most of the light samples.
+class FEnvironmentLight
+{
+public:
+    // Load an HDR image, such as Radiance .hdr or OpenEXR. 8-bit images are read as sRGB.
+    FEnvironmentLight(const FString& Path, float InIntensity = 1.0f);
+    // Radiance holds Width * Height texels, row by row.
+    FEnvironmentLight(int32 InWidth, int32 InHeight, const TArray<FVector>& InRadiance, float InIntensity = 1.0f);
+
+    // False if the image failed to load or is black everywhere.
+    bool IsValid() const { return !Distribution.IsEmpty(); }
+
+    // Radiance arriving along -Direction, that is seen when looking towards Direction.
+    FVector Evaluate(const FVector& Direction) const;
+
+    // A direction towards the environment, its radiance and its solid angle pdf.
+    FVector Sample(const FVector2& U, FVector& OutDirection, float& OutPDF) const;
+    float PDF(const FVector& Direction) const;
+
+    // Hash of the size, the intensity and every texel, to tell maps apart without comparing them.
+    uint64 GetChecksum() const { return Checksum; }
+
+private:
+    void BuildDistribution();
+
+    static FVector ToDirection(const FVector2& Point);
+    static FVector2 ToPoint(const FVector& Direction);
+
+    FVector Lookup(const FVector2& Point) const;
+
+private:
+    int32 Width = 0;
+    int32 Height = 0;
+    TArray<FVector> Radiance;
+    float Intensity = 1.0f;
+    uint64 Checksum = 0;
+
+    FDistribution2D Distribution;
+};
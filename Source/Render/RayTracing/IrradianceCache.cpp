@@ -0,0 +1,254 @@
+#include "Render/RayTracing/IrradianceCache.h"
+#include "Render/RayTracing/PixelStatistics.h"
+
+FIrradianceCache::FIrradianceCache(const FIrradianceCacheSettings& InSettings, const FBoundingBox& SceneBounds)
+    : ErrorTolerance(InSettings.ErrorTolerance), ThetaStrata(FMath::Max(InSettings.ThetaStrata, 1)),
+      MinPixelSpacing(InSettings.MinPixelSpacing), MaxPixelSpacing(FMath::Max(InSettings.MaxPixelSpacing, InSettings.MinPixelSpacing))
+{
+    PhiStrata = FMath::Max((int32)(PI * ThetaStrata + 0.5f), 3);
+
+    // A little larger than the scene, so points on its boundary fall inside.
+    FVector Diagonal = SceneBounds.Diagonal();
+    RootSize = FMath::Max(Diagonal.X, FMath::Max(Diagonal.Y, Diagonal.Z)) * 1.01f + KINDA_SMALL_NUMBER;
+    RootMin = SceneBounds.Centroid() - FVector(RootSize * 0.5f);
+    Nodes.emplace_back();
+}
+
+bool FIrradianceCache::Lookup(const FVector& Position, const FVector& Normal, FVector& OutIrradiance) const
+{
+    FVector Offset = Position - RootMin;
+    if (Offset.X < 0.0f || Offset.Y < 0.0f || Offset.Z < 0.0f || Offset.X >= RootSize || Offset.Y >= RootSize || Offset.Z >= RootSize)
+    {
+        return false;
+    }
+
+    // Every record covering Position is stored in a node on the way from the root to the leaf that contains it.
+    FVector Sum = FVector::ZeroVector;
+    float WeightSum = 0.0f;
+    FVector NodeMin = RootMin;
+    float NodeSize = RootSize;
+    for (int32 NodeIndex = 0; NodeIndex >= 0;)
+    {
+        const FOctreeNode& Node = Nodes[NodeIndex];
+        for (int32 RecordIndex : Node.Records)
+        {
+            const FIrradianceRecord& Record = Records[RecordIndex];
+
+            // Ward's error estimate of reusing the record here, from the distance and the normal divergence. Most records
+            // of a node are out of reach, which the distance alone tells.
+            FVector Delta = Position - Record.Position;
+            float MaxDistance = ErrorTolerance * Record.Radius;
+            float SquaredDistance = Delta.SquaredLength();
+            if (SquaredDistance >= MaxDistance * MaxDistance)
+            {
+                continue;
+            }
+            float Error = FMath::Sqrt(SquaredDistance) / Record.Radius + FMath::Sqrt(FMath::Max(0.0f, 1.0f - Normal.Dot(Record.Normal)));
+            if (Error >= ErrorTolerance)
+            {
+                continue;
+            }
+
+            // A record in front of the point sees surfaces the point may not.
+            if (Delta.Dot(Normal + Record.Normal) * 0.5f < -0.01f * Record.Radius)
+            {
+                continue;
+            }
+
+            // Falls off to zero at the edge of the record's influence, so records do not pop in.
+            float Weight = 1.0f / FMath::Max(Error, 1e-4f) - 1.0f / ErrorTolerance;
+            FVector Rotation = FVector::CrossProduct(Record.Normal, Normal);
+            FVector Irradiance = Record.Irradiance;
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                Irradiance[Channel] += Rotation.Dot(Record.RotationGradient[Channel]) + Delta.Dot(Record.TranslationGradient[Channel]);
+            }
+            Sum += Irradiance * Weight;
+            WeightSum += Weight;
+        }
+
+        NodeSize *= 0.5f;
+        FVector Center = NodeMin + FVector(NodeSize);
+        int32 Child = (Position.X >= Center.X ? 1 : 0) | (Position.Y >= Center.Y ? 2 : 0) | (Position.Z >= Center.Z ? 4 : 0);
+        NodeMin = FVector(Child & 1 ? Center.X : NodeMin.X, Child & 2 ? Center.Y : NodeMin.Y, Child & 4 ? Center.Z : NodeMin.Z);
+        NodeIndex = Node.Children[Child];
+    }
+
+    if (WeightSum <= 0.0f)
+    {
+        return false;
+    }
+    OutIrradiance = FVector::Max(Sum / WeightSum, FVector::ZeroVector);
+    return true;
+}
+
+FVector FIrradianceCache::GetSampleDirection(const FVector& Normal, int32 Theta, int32 Phi, const FVector2& U) const
+{
+    // Uniform in sin^2(theta) and phi, which is cosine-weighted.
+    float SinTheta2 = (Theta + U.X) / ThetaStrata;
+    float SinTheta = FMath::Sqrt(SinTheta2);
+    float CosTheta = FMath::Sqrt(FMath::Max(0.0f, 1.0f - SinTheta2));
+    float PhiAngle = 2.0f * PI * (Phi + U.Y) / PhiStrata;
+
+    FVector E1, E2;
+    BuildBasis(Normal, E1, E2);
+    return E1 * (FMath::Cos(PhiAngle) * SinTheta) + E2 * (FMath::Sin(PhiAngle) * SinTheta) + Normal * CosTheta;
+}
+
+FVector FIrradianceCache::GetSampleDirection(const FVector& Normal, const FVector2& U)
+{
+    float SinTheta = FMath::Sqrt(U.X);
+    float CosTheta = FMath::Sqrt(FMath::Max(0.0f, 1.0f - U.X));
+    float PhiAngle = 2.0f * PI * U.Y;
+
+    FVector E1, E2;
+    BuildBasis(Normal, E1, E2);
+    return E1 * (FMath::Cos(PhiAngle) * SinTheta) + E2 * (FMath::Sin(PhiAngle) * SinTheta) + Normal * CosTheta;
+}
+
+FVector FIrradianceCache::AddRecord(const FVector& Position, const FVector& Normal, const TArray<FVector>& Radiance,
+                                    const TArray<float>& Distance, float PixelWidth)
+{
+    FIrradianceRecord Record;
+    Record.Position = Position;
+    Record.Normal = Normal;
+
+    FVector E1, E2;
+    BuildBasis(Normal, E1, E2);
+
+    // Each cosine-weighted stratum stands for PI / (M * N) of the irradiance.
+    float StratumWeight = PI / (ThetaStrata * PhiStrata);
+    float InverseDistanceSum = 0.0f;
+    for (int32 Phi = 0; Phi < PhiStrata; ++Phi)
+    {
+        // Stratum centers, and the lower phi edge shared with the previous sector.
+        float PhiCenter = 2.0f * PI * (Phi + 0.5f) / PhiStrata;
+        float PhiEdge = 2.0f * PI * Phi / PhiStrata;
+        FVector Radial = E1 * FMath::Cos(PhiCenter) + E2 * FMath::Sin(PhiCenter);
+        FVector Tangent = E2 * FMath::Cos(PhiCenter) - E1 * FMath::Sin(PhiCenter);
+        FVector EdgeTangent = E2 * FMath::Cos(PhiEdge) - E1 * FMath::Sin(PhiEdge);
+        int32 PreviousPhi = (Phi + PhiStrata - 1) % PhiStrata;
+
+        for (int32 Theta = 0; Theta < ThetaStrata; ++Theta)
+        {
+            int32 Index = Theta * PhiStrata + Phi;
+            const FVector& L = Radiance[Index];
+            float SinTheta2 = (Theta + 0.5f) / ThetaStrata;
+            float SinTheta = FMath::Sqrt(SinTheta2);
+            float TanTheta = SinTheta / FMath::Sqrt(1.0f - SinTheta2);
+            float SinThetaLow = FMath::Sqrt((float)Theta / ThetaStrata);
+            float CosThetaLow = FMath::Sqrt(1.0f - (float)Theta / ThetaStrata);
+            float CosThetaHigh = FMath::Sqrt(1.0f - (float)(Theta + 1) / ThetaStrata);
+
+            Record.Irradiance += L * StratumWeight;
+            if (Distance[Index] < FLOAT_MAX)
+            {
+                InverseDistanceSum += 1.0f / FMath::Max(Distance[Index], KINDA_SMALL_NUMBER);
+            }
+
+            // Tilting the normal by a small angle towards a direction scales its cosine by 1 + tan(theta) * angle.
+            FVector RotationWeight = Tangent * (TanTheta * StratumWeight);
+
+            // Moving the point shifts the edges between strata by the inverse distance of the closer side: across the
+            // theta edge below this stratum and across the phi edge before it.
+            FVector ThetaEdgeWeight;
+            if (Theta > 0)
+            {
+                int32 LowerIndex = Index - PhiStrata;
+                float EdgeDistance = FMath::Max(FMath::Min(Distance[Index], Distance[LowerIndex]), KINDA_SMALL_NUMBER);
+                ThetaEdgeWeight = Radial * (2.0f * PI / PhiStrata * SinThetaLow * CosThetaLow * CosThetaLow / EdgeDistance);
+            }
+            int32 PreviousIndex = Theta * PhiStrata + PreviousPhi;
+            float PhiEdgeDistance = FMath::Max(FMath::Min(Distance[Index], Distance[PreviousIndex]), KINDA_SMALL_NUMBER);
+            FVector PhiEdgeWeight = EdgeTangent * ((CosThetaLow - CosThetaHigh) / (SinTheta * PhiEdgeDistance));
+
+            for (int32 Channel = 0; Channel < 3; ++Channel)
+            {
+                Record.RotationGradient[Channel] += RotationWeight * L[Channel];
+                Record.TranslationGradient[Channel] += PhiEdgeWeight * (L[Channel] - Radiance[PreviousIndex][Channel]);
+                if (Theta > 0)
+                {
+                    Record.TranslationGradient[Channel] += ThetaEdgeWeight * (L[Channel] - Radiance[Index - PhiStrata][Channel]);
+                }
+            }
+        }
+    }
+
+    // Harmonic mean distance, and no further than the translation gradient predicts a large change. The record is
+    // reused up to ErrorTolerance times its radius, which the pixel spacing bounds.
+    float MinRadius = MinPixelSpacing * PixelWidth / ErrorTolerance;
+    float MaxRadius = MaxPixelSpacing * PixelWidth / ErrorTolerance;
+    float Radius = InverseDistanceSum > 0.0f ? ThetaStrata * PhiStrata / InverseDistanceSum : MaxRadius;
+    FVector LuminanceGradient = Record.TranslationGradient[0] * 0.2126f + Record.TranslationGradient[1] * 0.7152f +
+                                Record.TranslationGradient[2] * 0.0722f;
+    float Luminance = FPixelStatistics::GetLuminance(Record.Irradiance);
+    float GradientLength = LuminanceGradient.Length();
+    if (GradientLength > 0.0f)
+    {
+        Radius = FMath::Min(Radius, Luminance / GradientLength);
+    }
+    Record.Radius = FMath::Clamp(Radius, MinRadius, MaxRadius);
+
+    // Where the minimum spacing made the radius larger, the gradient is scaled down so extrapolating over the radius
+    // still changes the irradiance by at most its own value.
+    if (GradientLength * Record.Radius > Luminance)
+    {
+        float Scale = Luminance / (GradientLength * Record.Radius);
+        for (int32 Channel = 0; Channel < 3; ++Channel)
+        {
+            Record.TranslationGradient[Channel] *= Scale;
+        }
+    }
+
+    float InfluenceRadius = Record.Radius * ErrorTolerance;
+    FBoundingBox Influence(Position - FVector(InfluenceRadius), Position + FVector(InfluenceRadius));
+
+    int32 RecordIndex = (int32)Records.size();
+    Records.push_back(Record);
+    Insert(0, RootMin, RootSize, RecordIndex, Influence, 0);
+    return Record.Irradiance;
+}
+
+int32 FIrradianceCache::GetRecordNum() const
+{
+    return (int32)Records.size();
+}
+
+void FIrradianceCache::Insert(int32 NodeIndex, const FVector& NodeMin, float NodeSize, int32 RecordIndex, const FBoundingBox& Influence,
+                              int32 Depth)
+{
+    float ChildSize = NodeSize * 0.5f;
+    FVector InfluenceSize = Influence.Diagonal();
+    if (Depth == MaxOctreeDepth || ChildSize < 0.5f * FMath::Max(InfluenceSize.X, FMath::Max(InfluenceSize.Y, InfluenceSize.Z)))
+    {
+        Nodes[NodeIndex].Records.push_back(RecordIndex);
+        return;
+    }
+
+    FVector Center = NodeMin + FVector(ChildSize);
+    for (int32 Child = 0; Child < 8; ++Child)
+    {
+        FVector ChildMin = FVector(Child & 1 ? Center.X : NodeMin.X, Child & 2 ? Center.Y : NodeMin.Y, Child & 4 ? Center.Z : NodeMin.Z);
+        FVector ChildMax = ChildMin + FVector(ChildSize);
+        if (Influence.MaxPoint.X < ChildMin.X || Influence.MinPoint.X > ChildMax.X || Influence.MaxPoint.Y < ChildMin.Y ||
+            Influence.MinPoint.Y > ChildMax.Y || Influence.MaxPoint.Z < ChildMin.Z || Influence.MinPoint.Z > ChildMax.Z)
+        {
+            continue;
+        }
+
+        // Nodes may reallocate while the children are created, so the node is looked up by index every time.
+        if (Nodes[NodeIndex].Children[Child] < 0)
+        {
+            Nodes[NodeIndex].Children[Child] = (int32)Nodes.size();
+            Nodes.emplace_back();
+        }
+        Insert(Nodes[NodeIndex].Children[Child], ChildMin, ChildSize, RecordIndex, Influence, Depth + 1);
+    }
+}
+
+void FIrradianceCache::BuildBasis(const FVector& N, FVector& OutE1, FVector& OutE2)
+{
+    OutE2 = FMath::Abs(N.X) > FMath::Abs(N.Y) ? FVector(N.Z, 0.0f, -N.X) / FMath::Sqrt(N.X * N.X + N.Z * N.Z)
+                                              : FVector(0.0f, N.Z, -N.Y) / FMath::Sqrt(N.Y * N.Y + N.Z * N.Z);
+    OutE1 = FVector::CrossProduct(OutE2, N);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "Geometry/BoundingBox.h"
+
+struct FIrradianceCacheSettings
+{
+    // Largest interpolation error allowed (Ward's a). A record is reused up to ErrorTolerance times its radius away, so
+    // smaller values place more records and cost less bias. Zero turns the cache off.
+    float ErrorTolerance = 0.0f;
+    // A record traces ThetaStrata rings of about PI times as many sectors each.
+    int32 ThetaStrata = 12;
+    // Bounds of the distance a record is reused over, in pixels at the point where it was made. Irradiance detail
+    // finer than MinPixelSpacing is blurred, and smooth irradiance still gets a record every MaxPixelSpacing.
+    float MinPixelSpacing = 3.0f;
+    float MaxPixelSpacing = 30.0f;
+};
+
+struct FIrradianceRecord
+{
+    FVector Position;
+    FVector Normal;
+    FVector Irradiance;
+    // Harmonic mean distance of the surfaces around the record, clamped by the gradient and the spacing bounds.
+    float Radius = 0.0f;
+    // Per color channel: change of the irradiance per radian of normal rotation (about the rotation axis) and per unit
+    // of movement.
+    FVector RotationGradient[3];
+    FVector TranslationGradient[3];
+};
+
+// Cache of the indirect irradiance on diffuse surfaces (Ward et al. 1988, "A Ray Tracing Solution for Diffuse
+// Interreflection"), extrapolated to nearby points with its gradients (Ward and Heckbert 1992, "Irradiance Gradients").
+// Records are computed where no record is close enough, and stored in an octree by their radius of influence.
+// Lookups can run on many render threads at once, but only while no record is being added: the cache takes no locks.
+class FIrradianceCache
+{
+public:
+    FIrradianceCache(const FIrradianceCacheSettings& InSettings, const FBoundingBox& SceneBounds);
+
+    // Weighted mean of the records that cover Position on a surface facing Normal. False if there is none.
+    bool Lookup(const FVector& Position, const FVector& Normal, FVector& OutIrradiance) const;
+
+    // A new record samples the hemisphere around its normal in GetThetaStrata() x GetPhiStrata() cosine-weighted strata.
+    int32 GetThetaStrata() const { return ThetaStrata; }
+    int32 GetPhiStrata() const { return PhiStrata; }
+    FVector GetSampleDirection(const FVector& Normal, int32 Theta, int32 Phi, const FVector2& U) const;
+    // A cosine-weighted direction from the whole hemisphere, with the same mapping.
+    static FVector GetSampleDirection(const FVector& Normal, const FVector2& U);
+
+    // Build a record from the incident indirect radiance of each stratum and the distance its ray travelled (FLOAT_MAX
+    // if it escaped), indexed Theta * GetPhiStrata() + Phi, and add it. PixelWidth is the width a pixel covers at
+    // Position. Returns the record's irradiance. Must not overlap with other additions or lookups.
+    FVector AddRecord(const FVector& Position, const FVector& Normal, const TArray<FVector>& Radiance, const TArray<float>& Distance,
+                      float PixelWidth);
+
+    int32 GetRecordNum() const;
+
+private:
+    struct FOctreeNode
+    {
+        int32 Children[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+        TArray<int32> Records;
+    };
+
+    // Store the record in the nodes its influence overlaps, down to nodes about as large as the influence radius.
+    void Insert(int32 NodeIndex, const FVector& NodeMin, float NodeSize, int32 RecordIndex, const FBoundingBox& Influence, int32 Depth);
+
+    static void BuildBasis(const FVector& N, FVector& OutE1, FVector& OutE2);
+
+private:
+    static constexpr int32 MaxOctreeDepth = 16;
+
+    float ErrorTolerance;
+    int32 ThetaStrata;
+    int32 PhiStrata;
+    float MinPixelSpacing;
+    float MaxPixelSpacing;
+
+    // The octree's root is the cube around the scene bounds.
+    FVector RootMin;
+    float RootSize;
+
+    TArray<FIrradianceRecord> Records;
+    TArray<FOctreeNode> Nodes;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+// Running mean and variance of the luminance of one pixel's samples (Welford).
+// Statistics of separate passes are combined with the parallel update of Chan et al.
+struct FPixelStatistics
+{
+public:
+    FORCEINLINE void Add(const FVector& Radiance)
+    {
+        float Value = GetLuminance(Radiance);
+        SampleCount += 1;
+        float Delta = Value - Mean;
+        Mean += Delta / SampleCount;
+        M2 += Delta * (Value - Mean);
+    }
+
+    FORCEINLINE void Merge(const FPixelStatistics& Other)
+    {
+        if (Other.SampleCount == 0)
+        {
+            return;
+        }
+
+        int32 Count = SampleCount + Other.SampleCount;
+        float Delta = Other.Mean - Mean;
+        Mean += Delta * Other.SampleCount / Count;
+        M2 += Other.M2 + Delta * Delta * ((float)SampleCount * Other.SampleCount / Count);
+        SampleCount = Count;
+    }
+
+    FORCEINLINE float GetVariance() const { return SampleCount > 1 ? M2 / (SampleCount - 1) : 0.0f; }
+
+    // Standard error of the mean over the square root of the mean, a compromise between absolute error (which ignores
+    // dark regions) and relative error (which refines them forever). Means below MinLuminance count as MinLuminance.
+    FORCEINLINE float GetRelativeError(float MinLuminance) const
+    {
+        if (SampleCount < 2)
+        {
+            return FLOAT_MAX;
+        }
+        return FMath::Sqrt(GetVariance() / SampleCount) / FMath::Sqrt(FMath::Max(Mean, MinLuminance));
+    }
+
+    static FORCEINLINE float GetLuminance(const FVector& Radiance)
+    {
+        return 0.2126f * Radiance.X + 0.7152f * Radiance.Y + 0.0722f * Radiance.Z;
+    }
+
+public:
+    int32 SampleCount = 0;
+    float Mean = 0.0f;
+    float M2 = 0.0f;
+};
@@ -1,10 +1,19 @@
 #include "Render/RayTracing/RayTracingRenderer.h"
+#include "Render/RayTracing/WavefrontIntegrator.h"
+#include "Render/RayTracing/EnvironmentLight.h"
+#include "Render/ImageWriter.h"
 #include "RayTracing/BoundingVolumeHierarchy.h"
+#include "RayTracing/LightBVH.h"
 #include "RayTracing/HitResult.h"
 #include "RayTracing/Ray.h"
+#include "RayTracing/RayPacket.h"
 #include "Material/Material.h"
 #include "Geometry/Geometry.h"
 
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <opencv2/opencv.hpp>
 
@@ -12,7 +21,18 @@ FRayTracingRenderer::FRayTracingRenderer(int32 InWidth, int32 InHeight, const FC
     : Width(InWidth), Height(InHeight), Camera(InCamera)
 {
     FrameBuffer.resize((::std::size_t)(Width * Height));
+    AccumulationBuffer.resize((::std::size_t)(Width * Height));
+    PassBuffer.resize((::std::size_t)(Width * Height));
+    PixelStatistics.resize((::std::size_t)(Width * Height));
+    PassStatistics.resize((::std::size_t)(Width * Height));
+    ActivePixels.resize((::std::size_t)(Width * Height), 1);
+    FeatureBuffer.resize((::std::size_t)(Width * Height));
+    PassFeatureBuffer.resize((::std::size_t)(Width * Height));
     RenderThreadCount = ::std::thread::hardware_concurrency();
+
+    CameraScale = FMath::Tan(FMath::DegreesToRadians(Camera.GetCameraFov() * 0.5f));
+    AspectRatio = Width / (float)Height;
+    PixelSpreadAngle = FMath::Atan(2.0f * CameraScale / Height);
 }
 
 FRayTracingRenderer::~FRayTracingRenderer()
@@ -22,6 +42,21 @@ FRayTracingRenderer::~FRayTracingRenderer()
         delete BVH;
         BVH = nullptr;
     }
+    if (LightBVH != nullptr)
+    {
+        delete LightBVH;
+        LightBVH = nullptr;
+    }
+    if (Denoiser != nullptr)
+    {
+        delete Denoiser;
+        Denoiser = nullptr;
+    }
+    if (IrradianceCache != nullptr)
+    {
+        delete IrradianceCache;
+        IrradianceCache = nullptr;
+    }
 }
 
 void FRayTracingRenderer::AddMesh(FGeometry* Mesh)
@@ -32,10 +67,561 @@ void FRayTracingRenderer::AddMesh(FGeometry* Mesh)
 void FRayTracingRenderer::BuildBVH()
 {
     BVH = new FBoundingVolumeHierarchy(Meshes);
+
+    // Gather the emissive triangles once, so a light sample costs O(1) instead of two passes over the meshes.
+    EmissivePrimitives.clear();
+    for (FGeometry* Mesh : Meshes)
+    {
+        Mesh->GatherEmissivePrimitives(EmissivePrimitives);
+    }
+
+    TArray<float> Areas;
+    EmissionArea = 0.0f;
+    for (const FGeometry* Primitive : EmissivePrimitives)
+    {
+        Areas.emplace_back(Primitive->GetArea());
+        EmissionArea += Primitive->GetArea();
+    }
+    EmissiveAliasTable = FAliasTable(Areas);
+
+    if (LightBVH != nullptr)
+    {
+        delete LightBVH;
+        LightBVH = nullptr;
+    }
+    if (LightSamplingStrategy == ELightSamplingStrategy::LightBVH)
+    {
+        LightBVH = new FLightBVH(EmissivePrimitives);
+    }
+
+    // Records of the old scene are stale.
+    if (IrradianceCache != nullptr)
+    {
+        delete IrradianceCache;
+        IrradianceCache = nullptr;
+    }
+}
+
+void FRayTracingRenderer::SetIrradianceCaching(const FIrradianceCacheSettings& InIrradianceCacheSettings)
+{
+    IrradianceCacheSettings = InIrradianceCacheSettings;
+    if (IrradianceCache != nullptr)
+    {
+        delete IrradianceCache;
+        IrradianceCache = nullptr;
+    }
+}
+
+// Rays traced by the current thread since its last flush into TracedRayNum. Counting locally keeps atomics out of the
+// per-ray path.
+static thread_local int64 ThreadTracedRayNum = 0;
+
+static double GetTimeSeconds()
+{
+    return ::std::chrono::duration<double>(::std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifndef SOFT_HEADLESS
+// Tone mapped once per frame. FColor is packed BGRA, which is what OpenCV windows expect.
+static cv::Mat ToImage(const TArray<FVector>& FrameBuffer, int32 Width, int32 Height, const FToneMapSettings& ToneMapSettings)
+{
+    cv::Mat Image(Height, Width, CV_8UC4);
+    FToneMapper::Apply(ToneMapSettings, FrameBuffer.data(), reinterpret_cast<FColor*>(Image.data), Width * Height);
+    return Image;
 }
+#endif
 
 void FRayTracingRenderer::Render(int32 SPP, bool bMultiThread)
 {
+    // Files are encoded and written while the next passes render.
+    FAsyncImageWriter ImageWriter;
+
+    // Show the estimate after every pass. Esc stops early and keeps what has been accumulated.
+    // Headless, write it to the output file every PreviewInterval seconds instead.
+    double LastPreviewTime = GetTimeSeconds();
+    auto ShowPreview = [this, &ImageWriter, &LastPreviewTime](int32 AccumulatedSPP)
+    {
+#ifndef SOFT_HEADLESS
+        if (!bHeadless)
+        {
+            cv::imshow("Image", ToImage(FrameBuffer, Width, Height, ToneMapSettings));
+            if (cv::waitKey(1) == 27)
+            {
+                CancelRender();
+            }
+            return;
+        }
+#endif
+        if (PreviewInterval > 0.0 && GetTimeSeconds() - LastPreviewTime >= PreviewInterval)
+        {
+            ImageWriter.Write(OutputFilePath, FrameBuffer.data(), Width, Height, ToneMapSettings);
+            LastPreviewTime = GetTimeSeconds();
+        }
+    };
+
+    // Continue an interrupted job from its checkpoint.
+    if (CheckpointFilePath.empty() || !LoadCheckpoint(CheckpointFilePath))
+    {
+        ResetAccumulation();
+    }
+
+    if (RenderBudget.TimeSeconds > 0.0 || RenderBudget.ErrorTarget > 0.0f)
+    {
+        FRenderBudget Budget = RenderBudget;
+        Budget.MaxSPP = FMath::Min(Budget.MaxSPP, SPP);
+        RenderResult = RenderWithBudget(Budget, ShowPreview, bMultiThread);
+    }
+    else if (AdaptiveErrorThreshold > 0.0f)
+    {
+        RenderAdaptive(AdaptiveMinSPP, SPP, AdaptiveErrorThreshold, ShowPreview, bMultiThread);
+
+        TArray<FVector> Heatmap;
+        GetSampleCountHeatmap(Heatmap);
+        ImageWriter.Write(SampleCountFilePath, Heatmap.data(), Width, Height);
+    }
+    else
+    {
+        RenderProgressive(SPP, ShowPreview, bMultiThread);
+    }
+
+    TArray<FVector> Image;
+    if (bDenoise)
+    {
+        Denoise(Image);
+    }
+    else
+    {
+        Image = FrameBuffer;
+    }
+    ImageWriter.Write(OutputFilePath, Image.data(), Width, Height, ToneMapSettings);
+
+#ifndef SOFT_HEADLESS
+    if (!bHeadless)
+    {
+        cv::imshow("Image", ToImage(Image, Width, Height, ToneMapSettings));
+        cv::waitKey();
+    }
+#endif
+    if (!ImageWriter.Flush())
+    {
+        std::cout << "Failed to write " << OutputFilePath << "\n";
+    }
+}
+
+void FRayTracingRenderer::RenderImage(int32 SPP, bool bMultiThread)
+{
+    ResetAccumulation();
+    bCancelRequested = false;
+    StartProgressReporter(Height, (int64)Width * Height * SPP);
+
+    RenderPass(SPP, bMultiThread);
+
+    StopProgressReporter();
+}
+
+int32 FRayTracingRenderer::RenderProgressive(int32 MaxSPP, const FProgressiveCallback& Callback, bool bMultiThread)
+{
+    bCancelRequested = false;
+    int32 PassNum = FMath::Max(MaxSPP - AccumulatedSPP, 0);
+    StartProgressReporter(PassNum * Height, (int64)Width * Height * PassNum);
+    LastCheckpointTime = GetTimeSeconds();
+    ::std::fill(ActivePixels.begin(), ActivePixels.end(), 1);
+
+    while (AccumulatedSPP < MaxSPP && !bCancelRequested && RenderPass(1, bMultiThread))
+    {
+        if (Callback)
+        {
+            Callback(AccumulatedSPP);
+        }
+        UpdateCheckpoint(false);
+    }
+    UpdateCheckpoint(true);
+
+    StopProgressReporter();
+    return AccumulatedSPP;
+}
+
+int32 FRayTracingRenderer::RenderAdaptive(int32 MinSPP, int32 MaxSPP, float ErrorThreshold, const FProgressiveCallback& Callback,
+                                          bool bMultiThread)
+{
+    // The variance estimate needs at least two samples.
+    MinSPP = FMath::Clamp(MinSPP, 2, FMath::Max(MaxSPP, 2));
+
+    // The pass count is an upper bound: converged tiles end the render earlier.
+    bCancelRequested = false;
+    int32 PassNum = (FMath::Max(MaxSPP - AccumulatedSPP, 0) + MinSPP - 1) / MinSPP;
+    StartProgressReporter(PassNum * Height, (int64)Width * Height * FMath::Max(MaxSPP - AccumulatedSPP, 0));
+    LastCheckpointTime = GetTimeSeconds();
+
+    while (!bCancelRequested)
+    {
+        int32 PassSPP = 0;
+        if (AccumulatedSPP < MinSPP)
+        {
+            ::std::fill(ActivePixels.begin(), ActivePixels.end(), 1);
+            PassSPP = FMath::Min(MinSPP, MaxSPP) - AccumulatedSPP;
+        }
+        else if (AccumulatedSPP < MaxSPP && UpdateActivePixels(MaxSPP, ErrorThreshold) > 0)
+        {
+            PassSPP = FMath::Min(MinSPP, MaxSPP - AccumulatedSPP);
+        }
+
+        if (PassSPP <= 0 || !RenderPass(PassSPP, bMultiThread))
+        {
+            break;
+        }
+
+        if (Callback)
+        {
+            Callback(AccumulatedSPP);
+        }
+        UpdateCheckpoint(false);
+    }
+    UpdateCheckpoint(true);
+
+    StopProgressReporter();
+    return AccumulatedSPP;
+}
+
+FRenderResult FRayTracingRenderer::RenderWithBudget(const FRenderBudget& Budget, const FProgressiveCallback& Callback, bool bMultiThread)
+{
+    double StartTime = GetTimeSeconds();
+    FRenderResult Result;
+
+    // The progress report counts towards the sample limit, which the budget usually stops well before.
+    int32 MaxSPP = FMath::Max(Budget.MaxSPP, 1);
+    int32 PassNum = FMath::Max(MaxSPP - AccumulatedSPP, 0);
+
+    bCancelRequested = false;
+    StartProgressReporter(PassNum * Height, (int64)Width * Height * PassNum);
+    LastCheckpointTime = GetTimeSeconds();
+    ::std::fill(ActivePixels.begin(), ActivePixels.end(), 1);
+
+    // Passes take about the same time, so the last one predicts the next. Building the irradiance cache counts towards
+    // the budget, but happens before the first pass so that its time does not predict the second.
+    double PassSeconds = 0.0;
+    bool bCacheReady = PrepareIrradianceCache(bMultiThread);
+    while (true)
+    {
+        double PassStartTime = GetTimeSeconds();
+        if (AccumulatedSPP >= MaxSPP)
+        {
+            Result.StopReason = ERenderStopReason::SampleLimit;
+            break;
+        }
+        if (Budget.TimeSeconds > 0.0 && PassStartTime - StartTime + PassSeconds > Budget.TimeSeconds)
+        {
+            Result.StopReason = ERenderStopReason::TimeBudget;
+            break;
+        }
+        if (!bCacheReady || bCancelRequested || !RenderPass(1, bMultiThread))
+        {
+            Result.StopReason = ERenderStopReason::Cancelled;
+            break;
+        }
+        PassSeconds = GetTimeSeconds() - PassStartTime;
+
+        if (Callback)
+        {
+            Callback(AccumulatedSPP);
+        }
+        UpdateCheckpoint(false);
+
+        if (Budget.ErrorTarget > 0.0f && AccumulatedSPP >= 2 && GetMeanRelativeError() <= Budget.ErrorTarget)
+        {
+            Result.StopReason = ERenderStopReason::ErrorTarget;
+            break;
+        }
+    }
+    UpdateCheckpoint(true);
+    StopProgressReporter();
+
+    Result.SPP = AccumulatedSPP;
+    Result.ElapsedSeconds = GetTimeSeconds() - StartTime;
+    Result.MeanRelativeError = GetMeanRelativeError();
+    return Result;
+}
+
+// ********************
+//     Checkpoint
+// ********************
+
+struct FCheckpointHeader
+{
+    static constexpr uint32 CurrentMagic = 0x4b434752; // "RGCK"
+    static constexpr uint32 CurrentVersion = 4;
+
+    uint32 Magic = CurrentMagic;
+    uint32 Version = CurrentVersion;
+    int32 Width = 0;
+    int32 Height = 0;
+    int32 AccumulatedSPP = 0;
+
+    // Everything that decides the samples of a pixel besides its sample count.
+    uint32 RandomSeed = 0;
+    ESamplerType SamplerType = ESamplerType::Sobol;
+    EIntegratorType IntegratorType = EIntegratorType::MultipleImportanceSampling;
+    EMISHeuristic MISHeuristic = EMISHeuristic::Power;
+    int32 MaxDepth = 0;
+    int32 RouletteMinDepth = 0;
+    ELightSamplingStrategy LightSamplingStrategy = ELightSamplingStrategy::Area;
+    // Whether light samples may go to an environment light, and which map it is.
+    bool bEnvironmentLight = false;
+    uint64 EnvironmentLightChecksum = 0;
+    // The cache is rebuilt from these on resume, the same as the one the samples so far were shaded with.
+    FIrradianceCacheSettings IrradianceCacheSettings;
+};
+
+template <typename T>
+static void WriteArray(::std::ofstream& File, const TArray<T>& Array)
+{
+    File.write(reinterpret_cast<const char*>(Array.data()), (::std::streamsize)(Array.size() * sizeof(T)));
+}
+
+template <typename T>
+static void ReadArray(::std::ifstream& File, TArray<T>& Array)
+{
+    File.read(reinterpret_cast<char*>(Array.data()), (::std::streamsize)(Array.size() * sizeof(T)));
+}
+
+bool FRayTracingRenderer::SaveCheckpoint(const FAString& FilePath) const
+{
+    FCheckpointHeader Header;
+    Header.Width = Width;
+    Header.Height = Height;
+    Header.AccumulatedSPP = AccumulatedSPP;
+    Header.RandomSeed = RandomSeed;
+    Header.SamplerType = SamplerType;
+    Header.IntegratorType = IntegratorType;
+    Header.MISHeuristic = MISHeuristic;
+    Header.MaxDepth = MaxDepth;
+    Header.RouletteMinDepth = RouletteMinDepth;
+    Header.LightSamplingStrategy = LightSamplingStrategy;
+    Header.bEnvironmentLight = EnvironmentLight != nullptr;
+    Header.EnvironmentLightChecksum = EnvironmentLight != nullptr ? EnvironmentLight->GetChecksum() : 0;
+    Header.IrradianceCacheSettings = IrradianceCacheSettings;
+
+    // Write a temporary file and move it over the old checkpoint, so a job killed while writing keeps the previous one.
+    FAString TempFilePath = FilePath + ".tmp";
+    {
+        ::std::ofstream File(TempFilePath, ::std::ios::binary | ::std::ios::trunc);
+        if (!File)
+        {
+            return false;
+        }
+
+        File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+        WriteArray(File, AccumulationBuffer);
+        WriteArray(File, PixelStatistics);
+        WriteArray(File, FeatureBuffer);
+        WriteArray(File, ActivePixels);
+        if (!File.flush())
+        {
+            return false;
+        }
+    }
+
+    ::std::error_code ErrorCode;
+    ::std::filesystem::rename(TempFilePath, FilePath, ErrorCode);
+    return !ErrorCode;
+}
+
+bool FRayTracingRenderer::LoadCheckpoint(const FAString& FilePath)
+{
+    ::std::ifstream File(FilePath, ::std::ios::binary);
+    if (!File)
+    {
+        return false;
+    }
+
+    FCheckpointHeader Header;
+    File.read(reinterpret_cast<char*>(&Header), sizeof(Header));
+    if (!File || Header.Magic != FCheckpointHeader::CurrentMagic || Header.Version != FCheckpointHeader::CurrentVersion ||
+        Header.Width != Width || Header.Height != Height)
+    {
+        return false;
+    }
+
+    // Samples made with other settings would mix two different estimators into one image.
+    if (Header.RandomSeed != RandomSeed || Header.SamplerType != SamplerType || Header.IntegratorType != IntegratorType ||
+        Header.MISHeuristic != MISHeuristic || Header.MaxDepth != MaxDepth || Header.RouletteMinDepth != RouletteMinDepth ||
+        Header.LightSamplingStrategy != LightSamplingStrategy || Header.bEnvironmentLight != (EnvironmentLight != nullptr) ||
+        Header.EnvironmentLightChecksum != (EnvironmentLight != nullptr ? EnvironmentLight->GetChecksum() : 0))
+    {
+        return false;
+    }
+    const FIrradianceCacheSettings& CacheSettings = Header.IrradianceCacheSettings;
+    if (CacheSettings.ErrorTolerance != IrradianceCacheSettings.ErrorTolerance ||
+        CacheSettings.ThetaStrata != IrradianceCacheSettings.ThetaStrata ||
+        CacheSettings.MinPixelSpacing != IrradianceCacheSettings.MinPixelSpacing ||
+        CacheSettings.MaxPixelSpacing != IrradianceCacheSettings.MaxPixelSpacing)
+    {
+        return false;
+    }
+
+    // Read into new buffers, so a truncated file does not leave a half-loaded state behind.
+    ::std::size_t PixelNum = (::std::size_t)(Width * Height);
+    TArray<FVector> NewAccumulationBuffer(PixelNum);
+    TArray<FPixelStatistics> NewPixelStatistics(PixelNum);
+    TArray<FSurfaceFeatures> NewFeatureBuffer(PixelNum);
+    TArray<uint8> NewActivePixels(PixelNum);
+    ReadArray(File, NewAccumulationBuffer);
+    ReadArray(File, NewPixelStatistics);
+    ReadArray(File, NewFeatureBuffer);
+    ReadArray(File, NewActivePixels);
+    if (!File)
+    {
+        return false;
+    }
+
+    AccumulationBuffer.swap(NewAccumulationBuffer);
+    PixelStatistics.swap(NewPixelStatistics);
+    FeatureBuffer.swap(NewFeatureBuffer);
+    ActivePixels.swap(NewActivePixels);
+
+    AccumulatedSPP = Header.AccumulatedSPP;
+
+    for (int32 PixelIndex = 0; PixelIndex < Width * Height; ++PixelIndex)
+    {
+        int32 SampleCount = PixelStatistics[PixelIndex].SampleCount;
+        FrameBuffer[PixelIndex] = SampleCount > 0 ? AccumulationBuffer[PixelIndex] / SampleCount : FVector::ZeroVector;
+    }
+    return true;
+}
+
+void FRayTracingRenderer::UpdateCheckpoint(bool bForce)
+{
+    if (CheckpointFilePath.empty())
+    {
+        return;
+    }
+
+    double Now = GetTimeSeconds();
+    if (bForce || Now - LastCheckpointTime >= CheckpointInterval)
+    {
+        if (!SaveCheckpoint(CheckpointFilePath))
+        {
+            std::cout << "Failed to write checkpoint " << CheckpointFilePath << "\n";
+        }
+        LastCheckpointTime = Now;
+    }
+}
+
+int32 FRayTracingRenderer::UpdateActivePixels(int32 MaxSPP, float ErrorThreshold)
+{
+    // Decide per tile: the error estimate of a single pixel is too noisy after a few samples, and a pixel whose samples
+    // all missed the light would look converged.
+    constexpr int32 TileSize = 4;
+
+    int32 ActivePixelNum = 0;
+    for (int32 TileY = 0; TileY < Height; TileY += TileSize)
+    {
+        for (int32 TileX = 0; TileX < Width; TileX += TileSize)
+        {
+            int32 EndX = FMath::Min(TileX + TileSize, Width);
+            int32 EndY = FMath::Min(TileY + TileSize, Height);
+
+            bool bActive = false;
+            for (int32 Y = TileY; Y < EndY && !bActive; ++Y)
+            {
+                for (int32 X = TileX; X < EndX && !bActive; ++X)
+                {
+                    const FPixelStatistics& Statistics = PixelStatistics[Y * Width + X];
+                    bActive = Statistics.SampleCount < MaxSPP && Statistics.GetRelativeError(MinErrorLuminance) > ErrorThreshold;
+                }
+            }
+
+            for (int32 Y = TileY; Y < EndY; ++Y)
+            {
+                for (int32 X = TileX; X < EndX; ++X)
+                {
+                    ActivePixels[Y * Width + X] = bActive ? 1 : 0;
+                }
+            }
+            ActivePixelNum += bActive ? (EndX - TileX) * (EndY - TileY) : 0;
+        }
+    }
+    return ActivePixelNum;
+}
+
+void FRayTracingRenderer::Denoise(TArray<FVector>& OutImage)
+{
+    if (Denoiser == nullptr)
+    {
+        Denoiser = new FDenoiser(Width, Height);
+    }
+    Denoiser->SetSettings(DenoiserSettings);
+
+    // The denoiser scales its edge-stopping by the noise of each pixel's mean.
+    TArray<float> Variance(PixelStatistics.size());
+    for (int32 PixelIndex = 0; PixelIndex < (int32)PixelStatistics.size(); ++PixelIndex)
+    {
+        const FPixelStatistics& Statistics = PixelStatistics[PixelIndex];
+        Variance[PixelIndex] = Statistics.SampleCount > 0 ? Statistics.GetVariance() / Statistics.SampleCount : 0.0f;
+    }
+
+    OutImage.resize(FrameBuffer.size());
+    Denoiser->Denoise(FrameBuffer.data(), Variance.data(), FeatureBuffer.data(), OutImage.data(), RenderThreadCount);
+}
+
+void FRayTracingRenderer::GetSampleCountHeatmap(TArray<FVector>& OutHeatmap) const
+{
+    int32 MaxSampleCount = 1;
+    for (const FPixelStatistics& Statistics : PixelStatistics)
+    {
+        MaxSampleCount = FMath::Max(MaxSampleCount, Statistics.SampleCount);
+    }
+
+    OutHeatmap.resize(PixelStatistics.size());
+    for (int32 PixelIndex = 0; PixelIndex < (int32)PixelStatistics.size(); ++PixelIndex)
+    {
+        float T = (float)PixelStatistics[PixelIndex].SampleCount / MaxSampleCount;
+        OutHeatmap[PixelIndex] = FVector(T, 1.0f - FMath::Abs(2.0f * T - 1.0f), 1.0f - T);
+    }
+}
+
+int64 FRayTracingRenderer::GetTotalSampleCount() const
+{
+    int64 TotalSampleCount = 0;
+    for (const FPixelStatistics& Statistics : PixelStatistics)
+    {
+        TotalSampleCount += Statistics.SampleCount;
+    }
+    return TotalSampleCount;
+}
+
+float FRayTracingRenderer::GetMeanRelativeError() const
+{
+    double ErrorSum = 0.0;
+    int32 PixelNum = 0;
+    for (const FPixelStatistics& Statistics : PixelStatistics)
+    {
+        if (Statistics.SampleCount >= 2)
+        {
+            ErrorSum += Statistics.GetRelativeError(MinErrorLuminance);
+            ++PixelNum;
+        }
+    }
+    return PixelNum > 0 ? (float)(ErrorSum / PixelNum) : FLOAT_MAX;
+}
+
+void FRayTracingRenderer::ResetAccumulation()
+{
+    ::std::fill(AccumulationBuffer.begin(), AccumulationBuffer.end(), FVector::ZeroVector);
+    ::std::fill(FrameBuffer.begin(), FrameBuffer.end(), FVector::ZeroVector);
+    ::std::fill(PixelStatistics.begin(), PixelStatistics.end(), FPixelStatistics());
+    ::std::fill(FeatureBuffer.begin(), FeatureBuffer.end(), FSurfaceFeatures());
+    ::std::fill(ActivePixels.begin(), ActivePixels.end(), 1);
+    AccumulatedSPP = 0;
+}
+
+bool FRayTracingRenderer::RenderPass(int32 SPP, bool bMultiThread)
+{
+    if (!PrepareIrradianceCache(bMultiThread))
+    {
+        return false;
+    }
+
     int32 OneThreadRows = Height / RenderThreadCount + 1;
 
     if (bMultiThread)
@@ -59,147 +645,772 @@ void FRayTracingRenderer::Render(int32 SPP, bool bMultiThread)
         RenderThread(0, Height, SPP);
     }
 
-#pragma warning(disable : 4267)
-    cv::Mat Image(Height, Width, CV_32FC3);
-    for (int32 Row = 0; Row < Image.rows; ++Row)
+    // A cancelled pass is incomplete, so it is dropped and every pixel keeps the samples of whole passes.
+    if (bCancelRequested)
     {
-        for (int32 Col = 0; Col < Image.cols; ++Col)
+        return false;
+    }
+
+    AccumulatedSPP += SPP;
+    for (int32 PixelIndex = 0; PixelIndex < Width * Height; ++PixelIndex)
+    {
+        if (ActivePixels[PixelIndex])
         {
-            int32 Index = Row * Width + Col;
-            Image.at<cv::Vec3f>(Row, Col)[0] = FrameBuffer[Index].X;
-            Image.at<cv::Vec3f>(Row, Col)[1] = FrameBuffer[Index].Y;
-            Image.at<cv::Vec3f>(Row, Col)[2] = FrameBuffer[Index].Z;
+            int32 OldSampleCount = PixelStatistics[PixelIndex].SampleCount;
+            AccumulationBuffer[PixelIndex] += PassBuffer[PixelIndex];
+            PixelStatistics[PixelIndex].Merge(PassStatistics[PixelIndex]);
+
+            int32 SampleCount = PixelStatistics[PixelIndex].SampleCount;
+            FrameBuffer[PixelIndex] = AccumulationBuffer[PixelIndex] / SampleCount;
+
+            FSurfaceFeatures& Features = FeatureBuffer[PixelIndex];
+            const FSurfaceFeatures& PassFeatures = PassFeatureBuffer[PixelIndex];
+            Features.Albedo = (Features.Albedo * OldSampleCount + PassFeatures.Albedo) / SampleCount;
+            Features.Normal = (Features.Normal * OldSampleCount + PassFeatures.Normal) / SampleCount;
+            Features.Depth = (Features.Depth * OldSampleCount + PassFeatures.Depth) / SampleCount;
         }
     }
-    cv::imshow("Image", Image);
-    Image.convertTo(Image, CV_8UC3, 255.0f);
-    cv::imwrite("./RTImage.png", Image);
-    cv::waitKey();
-#pragma warning(default : 4267)
+    return true;
 }
 
 void FRayTracingRenderer::RenderThread(int32 Begin, int32 End, int32 SPP)
 {
-    float Scale = FMath::Tan(FMath::DegreesToRadians(Camera.GetCameraFov() * 0.5f));
-    float AspectRatio = Width / (float)Height;
+    // The wavefront stages do not query the irradiance cache.
+    if (TraceMode == ETraceMode::Wavefront && IrradianceCache == nullptr)
+    {
+        FWavefrontIntegrator Integrator(*this);
+        Integrator.RenderRows(Begin, End, SPP);
+        return;
+    }
 
-    for (int32 Row = Begin; Row < End; ++Row)
+    // One sampler per thread. Its values only depend on the pixel and the sample, never on which thread renders it.
+    FSampler* Sampler = FSampler::Create(SamplerType, RandomSeed, Width);
+
+    for (int32 Row = Begin; Row < End && !bCancelRequested; ++Row)
     {
+        int64 RowSampleNum = 0;
         for (int32 Col = 0; Col < Width; ++Col)
         {
+            int32 PixelIndex = Row * Width + Col;
+            if (!ActivePixels[PixelIndex])
+            {
+                continue;
+            }
+
+            // Continue the pixel's own sample sequence, which differs between pixels once sampling is adaptive.
+            int32 FirstSPPIndex = PixelStatistics[PixelIndex].SampleCount;
+            RowSampleNum += SPP;
+
             FVector RTPixelColor;
-            for (int32 SPPIndex = 0; SPPIndex < SPP; ++SPPIndex)
+            FPixelStatistics Statistics;
+            FSurfaceFeatures FeatureSum;
+            for (int32 SPPIndex = FirstSPPIndex; SPPIndex < FirstSPPIndex + SPP; ++SPPIndex)
             {
-                float X = (2 * (Col + FMath::RandomFloat()) / Width - 1) * Scale * AspectRatio;
-                float Y = (1 - 2 * (Row + FMath::RandomFloat()) / Height) * Scale;
+                Sampler->StartPixelSample(Col, Row, SPPIndex);
+                FRay Ray = GenerateCameraRay(Col, Row, Sampler->Get2D());
 
-                FVector Direction = FVector(-X, Y, 1.0f).GetSafeNormal();
-                FRay Ray = FRay(Camera.GetCameraLocation(), Direction);
+                FSurfaceFeatures Features;
+                FVector Radiance = RayTracing(Ray, *Sampler, Features);
+                RTPixelColor += Radiance;
+                Statistics.Add(Radiance);
 
-                RTPixelColor += RayTracing(Ray, 0);
+                FeatureSum.Albedo += Features.Albedo;
+                FeatureSum.Normal += Features.Normal;
+                FeatureSum.Depth += Features.Depth;
             }
 
-            int32 PixelIndex = Row * Width + Col;
-            FrameBuffer[PixelIndex] = RTPixelColor / SPP;
+            PassBuffer[PixelIndex] = RTPixelColor;
+            PassStatistics[PixelIndex] = Statistics;
+            PassFeatureBuffer[PixelIndex] = FeatureSum;
         }
-        Mutex.lock();
-        ++RowComplatedNum;
-        UpdateProgressBar((float)RowComplatedNum / Height);
-        Mutex.unlock();
+        ReportProgress(1, RowSampleNum);
     }
+
+    delete Sampler;
+    Sampler = nullptr;
 }
 
-FVector FRayTracingRenderer::RayTracing(const FRay& Ray, int32 Depth)
+FRay FRayTracingRenderer::GenerateCameraRay(int32 Col, int32 Row, const FVector2& PixelOffset) const
 {
-    FHitResult HitResult;
-    BVH->LineTrace(HitResult, Ray);
-    if (HitResult.bHit)
-    {
-        return Shade(HitResult, -Ray.Direction);
-    }
-    return FVector::ZeroVector;
+    float X = (2 * (Col + PixelOffset.X) / Width - 1) * CameraScale * AspectRatio;
+    float Y = (1 - 2 * (Row + PixelOffset.Y) / Height) * CameraScale;
+
+    FVector Direction = FVector(-X, Y, 1.0f).GetSafeNormal();
+    return FRay(Camera.GetCameraLocation(), Direction);
 }
 
-FVector FRayTracingRenderer::Shade(const FHitResult& Hit, const FVector& Wo)
+FVector FRayTracingRenderer::RayTracing(const FRay& Ray, FSampler& Sampler, FSurfaceFeatures& OutFeatures)
 {
+    FHitResult Hit;
+    Trace(Hit, Ray);
+    if (!Hit.bHit)
+    {
+        return GetEnvironmentRadiance(Ray.Direction);
+    }
+
+    FRayCone Cone(0.0f, PixelSpreadAngle);
+    ResolveAlbedo(Hit, Cone, Ray.Direction);
+    GetSurfaceFeatures(Hit, OutFeatures);
     if (Hit.Material->IsEmission())
     {
         return Hit.Material->Emission;
     }
 
-    FVector LoDirect;
+    if (IrradianceCache != nullptr)
+    {
+        return ShadeCached(Hit, Cone, -Ray.Direction, Sampler);
+    }
+    return TracePath(Hit, Cone, -Ray.Direction, Sampler, 0);
+}
+
+FVector FRayTracingRenderer::TracePath(FHitResult Hit, FRayCone Cone, FVector Wo, FSampler& Sampler, int32 Bounce)
+{
+    bool bMIS = IntegratorType == EIntegratorType::MultipleImportanceSampling;
+
+    FVector Radiance = FVector::ZeroVector;
+    FVector Throughput = FVector(1.0f);
+
+    for (;; ++Bounce)
     {
-        FHitResult LightHit;
+        FVector LoDirect;
+        FRay ShadowRay;
+        float LightDistance = 0.0f;
+        if (SampleDirectLight(Hit, Wo, Sampler, LoDirect, ShadowRay, LightDistance) && !IsOccluded(ShadowRay, LightDistance))
+        {
+            Radiance += Throughput * LoDirect;
+        }
+
+        // Draw the roulette and BSDF dimensions even if they end up unused, so every bounce consumes the same dimensions.
+        float URoulette = Sampler.Get1D();
+        FVector2 UBSDF = Sampler.Get2D();
+
+        FVector Wi;
         float PDF = 0.0f;
-        SampleLight(LightHit, PDF);
+        if (!ScatterPath(Hit, Wo, Bounce, URoulette, UBSDF, Throughput, Wi, PDF))
+        {
+            break;
+        }
 
-        FVector LightVector = LightHit.Location - Hit.Location;
-        FVector LightDirection = LightVector.GetSafeNormal();
+        Cone = Cone.Bounce(Hit.Time, Hit.Material->GetSpreadAngle());
 
-        FHitResult ObstacleHit;
-        BVH->LineTrace(ObstacleHit, FRay(Hit.Location, LightDirection));
+        FHitResult NextHit;
+        FRay NextRay = FRay::SpawnFromSurface(Hit.Location, Hit.Normal, Wi);
+        Trace(NextHit, NextRay);
+        if (!NextHit.bHit)
+        {
+            Radiance += Throughput * GetEscapedRadiance(Wi, PDF);
+            break;
+        }
 
-        if (ObstacleHit.Time - LightVector.Length() > -KINDA_SMALL_NUMBER)
+        if (NextHit.Material->IsEmission())
         {
-            FVector Fr = Hit.Material->Evaluate(LightDirection, Wo, Hit.Normal);
-            float R2 = LightVector.Length();
-            float CosA = FMath::Max(0.0f, FVector::DotProduct(LightDirection, Hit.Normal));
-            float CosB = FMath::Max(0.0f, FVector::DotProduct(-LightDirection, LightHit.Normal));
-            LoDirect = LightHit.Emission * Fr * CosA * CosB / (R2 * PDF);
+            // Without MIS the light was already accounted for by light sampling.
+            if (bMIS)
+            {
+                float Weight = MISWeight(PDF, LightPDF(NextHit, NextRay.Origin, Hit.Normal));
+                Radiance += Throughput * NextHit.Material->Emission * Weight;
+            }
+            break;
         }
+
+        Hit = NextHit;
+        ResolveAlbedo(Hit, Cone, Wi);
+        Wo = -Wi;
+    }
+
+    return Radiance;
+}
+
+FVector FRayTracingRenderer::ShadeCached(const FHitResult& Hit, const FRayCone& Cone, const FVector& Wo, FSampler& Sampler)
+{
+    // The cached irradiance leaves out what arrives straight from the lights, so light sampling covers all of the
+    // diffuse lobe's direct light.
+    FVector Radiance = FVector::ZeroVector;
+    FVector LoDirect;
+    FRay ShadowRay;
+    float LightDistance = 0.0f;
+    if (SampleDirectLight(Hit, Wo, Sampler, LoDirect, ShadowRay, LightDistance, true) && !IsOccluded(ShadowRay, LightDistance))
+    {
+        Radiance += LoDirect;
     }
 
-    FVector LoIndirect = FVector::ZeroVector;
-    if (FMath::RandomFloat() < RussianRoulette)
+    // The same dimensions as a path vertex, though there is no roulette here and the BSDF sample may go unused. One
+    // more sample for the diffuse bounce of points without a record.
+    Sampler.Get1D();
+    FVector2 UBSDF = Sampler.Get2D();
+    FVector2 UDiffuse = Sampler.Get2D();
+    if (MaxDepth <= 1)
     {
-        FVector Wi = Hit.Material->Sample(Wo, Hit.Normal);
-        float PDF = Hit.Material->PDF(Wo, Wi, Hit.Normal);
-        if (PDF > SMALL_NUMBER)
+        return Radiance;
+    }
+
+    // Diffuse lobe: the Lambertian BRDF times the cached irradiance around the shading normal.
+    FRayCone NextCone = Cone.Bounce(Hit.Time, Hit.Material->GetSpreadAngle());
+    if (Hit.ShadingNormal.Dot(Wo) > 0.0f)
+    {
+        FVector Irradiance;
+        if (IrradianceCache->Lookup(Hit.Location, Hit.ShadingNormal, Irradiance))
         {
-            FHitResult NextHit;
-            BVH->LineTrace(NextHit, FRay(Hit.Location, Wi));
-            if (NextHit.bHit && !NextHit.Material->IsEmission())
+            Radiance += Hit.Albedo * Irradiance * PI_INV;
+        }
+        else
+        {
+            // Points the pre-pass left uncovered trace one cosine-weighted bounce, whose radiance estimates the irradiance
+            // over PI. The cache stays as the pre-pass left it. As in a record, emitters and the environment are left to
+            // the light sample.
+            FVector Wi = FIrradianceCache::GetSampleDirection(Hit.ShadingNormal, UDiffuse);
+            if (FVector::DotProduct(Wi, Hit.Normal) > 0.0f)
             {
-                FVector Fr = Hit.Material->Evaluate(Wi, Wo, Hit.Normal);
-                float Cos = FMath::Max(0.0f, FVector::DotProduct(Wi, Hit.Normal));
-                LoIndirect = Shade(NextHit, -Wi) * Fr * Cos / (PDF * RussianRoulette);
+                FHitResult NextHit;
+                Trace(NextHit, FRay::SpawnFromSurface(Hit.Location, Hit.Normal, Wi));
+                if (NextHit.bHit && !NextHit.Material->IsEmission())
+                {
+                    ResolveAlbedo(NextHit, NextCone, Wi);
+                    Radiance += Hit.Albedo * TracePath(NextHit, NextCone, -Wi, Sampler, 1);
+                }
             }
         }
     }
 
-    return LoDirect + LoIndirect;
+    // Other lobes: a BSDF sample weighted by the BRDF without its diffuse part, which is the BRDF of a black albedo.
+    // Lights it finds share their weight with the light sample, as on any path vertex.
+    if (Hit.Material->IsLambertian())
+    {
+        return Radiance;
+    }
+    FVector Wi = Hit.Material->Sample(Wo, Hit.ShadingNormal, UBSDF);
+    float PDF = Hit.Material->PDF(Wi, Wo, Hit.ShadingNormal);
+    if (PDF <= SMALL_NUMBER || FVector::DotProduct(Wi, Hit.Normal) <= 0.0f)
+    {
+        return Radiance;
+    }
+
+    FVector Fr = Hit.Material->Evaluate(Wi, Wo, Hit.ShadingNormal, FVector::ZeroVector);
+    FVector Throughput = Fr * FMath::Max(0.0f, FVector::DotProduct(Wi, Hit.ShadingNormal)) / PDF;
+
+    FHitResult NextHit;
+    FRay NextRay = FRay::SpawnFromSurface(Hit.Location, Hit.Normal, Wi);
+    Trace(NextHit, NextRay);
+    if (!NextHit.bHit)
+    {
+        Radiance += Throughput * GetEscapedRadiance(Wi, PDF);
+    }
+    else if (NextHit.Material->IsEmission())
+    {
+        if (IntegratorType == EIntegratorType::MultipleImportanceSampling)
+        {
+            float Weight = MISWeight(PDF, LightPDF(NextHit, NextRay.Origin, Hit.Normal));
+            Radiance += Throughput * NextHit.Material->Emission * Weight;
+        }
+    }
+    else
+    {
+        ResolveAlbedo(NextHit, NextCone, Wi);
+        Radiance += Throughput * TracePath(NextHit, NextCone, -Wi, Sampler, 1);
+    }
+    return Radiance;
+}
+
+// Seeds the hemisphere rays of a record, so a record at the same point always sees the same rays.
+static uint32 HashPosition(const FVector& Position)
+{
+    uint32 Bits[3];
+    ::std::memcpy(Bits, &Position.X, sizeof(float));
+    ::std::memcpy(Bits + 1, &Position.Y, sizeof(float));
+    ::std::memcpy(Bits + 2, &Position.Z, sizeof(float));
+    return (Bits[0] * 73856093u) ^ (Bits[1] * 19349663u) ^ (Bits[2] * 83492791u);
 }
 
-void FRayTracingRenderer::SampleLight(FHitResult& OutHit, float& OutPdf)
+bool FRayTracingRenderer::PrepareIrradianceCache(bool bMultiThread)
 {
-    float EmissionArea = 0.0f;
-    for (const FGeometry* Mesh : Meshes)
+    if (IrradianceCacheSettings.ErrorTolerance <= 0.0f || IrradianceCache != nullptr)
     {
-        EmissionArea += (Mesh->IsEmission() ? Mesh->GetArea() : 0.0f);
+        return true;
     }
+    IrradianceCache = new FIrradianceCache(IrradianceCacheSettings, BVH->GetBoundingBox());
+    return PopulateIrradianceCache(bMultiThread);
+}
 
-    float P = FMath::RandomFloat() * EmissionArea;
-    EmissionArea = 0.0f;
-    for (FGeometry* Mesh : Meshes)
+bool FRayTracingRenderer::PopulateIrradianceCache(bool bMultiThread)
+{
+    if (MaxDepth <= 1)
+    {
+        return true;
+    }
+
+    // Four points per pixel cover most of the area the jittered camera rays reach.
+    TArray<FHitResult> RowHits((::std::size_t)(Width * 4));
+    TArray<FVector> RowDirections((::std::size_t)(Width * 4));
+    for (int32 Row = 0; Row < Height && !bCancelRequested; ++Row)
     {
-        if (Mesh->IsEmission())
+        // The hits of a row are traced in parallel, then visited in order on this thread, so every record is made at the
+        // same point and sees the same records before it, whatever the thread count.
+        ParallelFor(Width * 4, bMultiThread,
+                    [this, Row, &RowHits, &RowDirections](int32 SubPixel)
+                    {
+                        FVector2 Offset = FVector2((SubPixel & 1) ? 0.75f : 0.25f, (SubPixel & 2) ? 0.75f : 0.25f);
+                        FRay Ray = GenerateCameraRay(SubPixel >> 2, Row, Offset);
+                        RowDirections[SubPixel] = Ray.Direction;
+                        RowHits[SubPixel] = FHitResult();
+                        Trace(RowHits[SubPixel], Ray);
+                    });
+
+        for (int32 SubPixel = 0; SubPixel < Width * 4; ++SubPixel)
         {
-            EmissionArea += Mesh->GetArea();
-            if (EmissionArea >= P)
+            const FHitResult& Hit = RowHits[SubPixel];
+            if (!Hit.bHit || Hit.Material->IsEmission() || Hit.ShadingNormal.Dot(-RowDirections[SubPixel]) <= 0.0f)
             {
-                Mesh->Sample(OutHit, OutPdf);
-                return;
+                continue;
             }
+
+            // The same cones as ShadeCached.
+            FRayCone Cone(0.0f, PixelSpreadAngle);
+            FRayCone NextCone = Cone.Bounce(Hit.Time, Hit.Material->GetSpreadAngle());
+            FVector Irradiance;
+            if (!IrradianceCache->Lookup(Hit.Location, Hit.ShadingNormal, Irradiance))
+            {
+                ComputeIrradianceRecord(Hit, NextCone, Cone.GetWidth(Hit.Time), bMultiThread);
+            }
+        }
+    }
+
+    // A partial cache would differ from the one an uninterrupted render builds.
+    if (bCancelRequested)
+    {
+        delete IrradianceCache;
+        IrradianceCache = nullptr;
+        return false;
+    }
+    return true;
+}
+
+FVector FRayTracingRenderer::ComputeIrradianceRecord(const FHitResult& Hit, const FRayCone& Cone, float PixelWidth, bool bMultiThread)
+{
+    int32 ThetaStrata = IrradianceCache->GetThetaStrata();
+    int32 PhiStrata = IrradianceCache->GetPhiStrata();
+    TArray<FVector> Radiance((::std::size_t)(ThetaStrata * PhiStrata));
+    TArray<float> Distance((::std::size_t)(ThetaStrata * PhiStrata), FLOAT_MAX);
+
+    // Every stratum seeds its own samples, so the strata can be split between threads without changing the record.
+    int32 RecordKey = (int32)(HashPosition(Hit.Location) & 0x7FFFFFFFu);
+    ParallelFor(ThetaStrata * PhiStrata, bMultiThread,
+                [this, &Hit, &Cone, &Radiance, &Distance, RecordKey, PhiStrata](int32 Index)
+                {
+                    FIndependentSampler RecordSampler(RandomSeed, 0);
+                    RecordSampler.StartPixelSample(RecordKey, 0, Index);
+                    FVector Direction =
+                        IrradianceCache->GetSampleDirection(Hit.ShadingNormal, Index / PhiStrata, Index % PhiStrata, RecordSampler.Get2D());
+                    if (FVector::DotProduct(Direction, Hit.Normal) <= 0.0f)
+                    {
+                        return;
+                    }
+
+                    FHitResult NextHit;
+                    Trace(NextHit, FRay::SpawnFromSurface(Hit.Location, Hit.Normal, Direction));
+                    if (!NextHit.bHit)
+                    {
+                        return;
+                    }
+
+                    // Emitters and the environment are direct light, which the shading point samples itself.
+                    Distance[Index] = NextHit.Time;
+                    if (!NextHit.Material->IsEmission())
+                    {
+                        ResolveAlbedo(NextHit, Cone, Direction);
+                        Radiance[Index] = TracePath(NextHit, Cone, -Direction, RecordSampler, 1);
+                    }
+                });
+    return IrradianceCache->AddRecord(Hit.Location, Hit.ShadingNormal, Radiance, Distance, PixelWidth);
+}
+
+bool FRayTracingRenderer::SampleDirectLight(const FHitResult& Hit, const FVector& Wo, FSampler& Sampler, FVector& OutLo, FRay& OutShadowRay,
+                                            float& OutLightDistance, bool bDiffuseCached)
+{
+    float ULight = Sampler.Get1D();
+    FVector2 UPoint = Sampler.Get2D();
+
+    // The light sample as a direction, its solid angle pdf and its emission.
+    FVector LightDirection;
+    float LightPDF = 0.0f;
+    FVector Emission;
+    FHitResult LightHit;
+    float EnvironmentProbability = GetEnvironmentLightProbability();
+    bool bEnvironment = ULight < EnvironmentProbability;
+    if (bEnvironment)
+    {
+        Emission = EnvironmentLight->Sample(UPoint, LightDirection, LightPDF);
+        LightPDF *= EnvironmentProbability;
+        if (LightPDF <= 0.0f)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        float LightAreaPDF = 0.0f;
+        float UArea = (ULight - EnvironmentProbability) / (1.0f - EnvironmentProbability);
+        SampleLight(LightHit, LightAreaPDF, Hit.Location, Hit.Normal, UArea, UPoint);
+
+        FVector LightVector = LightHit.Location - Hit.Location;
+        float LightDistance = LightVector.Length();
+        LightDirection = LightVector.GetSafeNormal();
+
+        float CosB = FMath::Max(0.0f, FVector::DotProduct(-LightDirection, LightHit.Normal));
+        if (LightAreaPDF <= 0.0f || CosB <= 0.0f)
+        {
+            return false;
+        }
+
+        // Convert the area pdf to solid angle: pdf * r^2 / cos(theta_light).
+        LightPDF = LightAreaPDF * LightDistance * LightDistance / CosB;
+        Emission = LightHit.Emission;
+    }
+
+    // The BSDF sees the shading normal, but light from behind the geometric surface cannot arrive.
+    float CosA = FMath::Max(0.0f, FVector::DotProduct(LightDirection, Hit.ShadingNormal));
+    if (CosA <= 0.0f || FVector::DotProduct(LightDirection, Hit.Normal) <= 0.0f)
+    {
+        return false;
+    }
+
+    bool bMIS = IntegratorType == EIntegratorType::MultipleImportanceSampling;
+    float Weight = bMIS ? MISWeight(LightPDF, Hit.Material->PDF(LightDirection, Wo, Hit.ShadingNormal)) : 1.0f;
+
+    FVector Fr = Hit.Material->Evaluate(LightDirection, Wo, Hit.ShadingNormal, Hit.Albedo);
+    if (bDiffuseCached)
+    {
+        // The BRDF of a black albedo is the BRDF without its diffuse lobe.
+        FVector FrOther = Hit.Material->Evaluate(LightDirection, Wo, Hit.ShadingNormal, FVector::ZeroVector);
+        OutLo = Emission * (Fr - FrOther + FrOther * Weight) * CosA / LightPDF;
+    }
+    else
+    {
+        OutLo = Emission * Fr * CosA * Weight / LightPDF;
+    }
+    OutShadowRay = FRay::SpawnFromSurface(Hit.Location, Hit.Normal, LightDirection);
+    if (bEnvironment)
+    {
+        // Any hit blocks the environment.
+        OutLightDistance = FLOAT_MAX;
+        return true;
+    }
+
+    // Aim from the offset origin, so the shadow ray still ends at the light sample.
+    FVector ShadowVector = LightHit.Location - OutShadowRay.Origin;
+    OutLightDistance = ShadowVector.Length();
+    OutShadowRay.Direction = ShadowVector.GetSafeNormal();
+    return true;
+}
+
+bool FRayTracingRenderer::ScatterPath(const FHitResult& Hit, const FVector& Wo, int32 Bounce, float URoulette, const FVector2& UBSDF,
+                                      FVector& InOutThroughput, FVector& OutWi, float& OutPDF) const
+{
+    if (Bounce + 1 >= MaxDepth)
+    {
+        return false;
+    }
+
+    // BSDF sampling.
+    // Directions around the shading normal may still point into the geometric surface: those paths end here.
+    OutWi = Hit.Material->Sample(Wo, Hit.ShadingNormal, UBSDF);
+    OutPDF = Hit.Material->PDF(OutWi, Wo, Hit.ShadingNormal);
+    if (OutPDF <= SMALL_NUMBER || FVector::DotProduct(OutWi, Hit.Normal) <= 0.0f)
+    {
+        return false;
+    }
+
+    FVector Fr = Hit.Material->Evaluate(OutWi, Wo, Hit.ShadingNormal, Hit.Albedo);
+    float Cos = FMath::Max(0.0f, FVector::DotProduct(OutWi, Hit.ShadingNormal));
+    InOutThroughput *= Fr * Cos / OutPDF;
+
+    // Russian roulette: survive with the probability of the remaining throughput, so dim paths end early.
+    if (Bounce + 1 >= RouletteMinDepth)
+    {
+        float Survival = FMath::Min(FMath::Max(InOutThroughput.X, FMath::Max(InOutThroughput.Y, InOutThroughput.Z)), 1.0f);
+        if (URoulette >= Survival)
+        {
+            return false;
+        }
+        InOutThroughput /= Survival;
+    }
+    return true;
+}
+
+void FRayTracingRenderer::Trace(FHitResult& OutHit, const FRay& Ray)
+{
+    FHitRecord Record;
+    Trace(Record, Ray);
+    GetSurfaceInteraction(Record, OutHit);
+}
+
+void FRayTracingRenderer::Trace(FHitRecord& OutRecord, const FRay& Ray)
+{
+    BVH->LineTrace(OutRecord, Ray);
+    ++ThreadTracedRayNum;
+}
+
+void FRayTracingRenderer::GetSurfaceInteraction(const FHitRecord& Record, FHitResult& OutHit)
+{
+    OutHit = FHitResult();
+    if (Record.IsHit())
+    {
+        Record.Primitive->GetSurfaceInteraction(Record, OutHit);
+    }
+}
+
+void FRayTracingRenderer::TracePacket(FRayPacket& Packet)
+{
+    BVH->LineTracePacket(Packet, Packet.GetFullMask());
+    ThreadTracedRayNum += Packet.Num;
+}
+
+void FRayTracingRenderer::ResolveAlbedo(FHitResult& InOutHit, const FRayCone& Cone, const FVector& Direction)
+{
+    // The cone's cross section, stretched by the incidence angle and measured in texture coordinates.
+    float Cos = FMath::Max(FMath::Abs(FVector::DotProduct(Direction, InOutHit.Normal)), KINDA_SMALL_NUMBER);
+    float Footprint = Cone.GetWidth(InOutHit.Time) / Cos * InOutHit.TexCoordDensity;
+    InOutHit.Albedo = InOutHit.Material->GetAlbedo(InOutHit.TexCoord, Footprint);
+}
+
+bool FRayTracingRenderer::IsOccluded(const FRay& ShadowRay, float Distance)
+{
+    FHitRecord ObstacleHit;
+    Trace(ObstacleHit, ShadowRay);
+    return IsOccluding(ObstacleHit, Distance);
+}
+
+bool FRayTracingRenderer::IsOccluding(const FHitRecord& ObstacleHit, float Distance)
+{
+    return ObstacleHit.Time - Distance <= -KINDA_SMALL_NUMBER;
+}
+
+void FRayTracingRenderer::GetSurfaceFeatures(const FHitResult& Hit, FSurfaceFeatures& OutFeatures)
+{
+    // Lights keep their emission in the denoiser instead of being divided by a reflectance.
+    OutFeatures.Normal = Hit.ShadingNormal;
+    OutFeatures.Depth = Hit.Time;
+    OutFeatures.Albedo = Hit.Material->IsEmission() ? FVector(1.0f) : FVector::Min(Hit.Albedo + Hit.Material->Ks, FVector(1.0f));
+}
+
+void FRayTracingRenderer::ParallelFor(int32 Num, bool bMultiThread, const ::std::function<void(int32 Index)>& Body)
+{
+    int32 ThreadCount = bMultiThread ? FMath::Min(RenderThreadCount, Num) : 1;
+    if (ThreadCount <= 1)
+    {
+        for (int32 Index = 0; Index < Num; ++Index)
+        {
+            Body(Index);
         }
+        return;
     }
+
+    TArray<::std::thread> Workers;
+    for (int32 ThreadIndex = 0; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        Workers.emplace_back(
+            [this, &Body, Num, ThreadCount, ThreadIndex]()
+            {
+                for (int32 Index = ThreadIndex; Index < Num; Index += ThreadCount)
+                {
+                    Body(Index);
+                }
+                // Only flushes the rays this thread traced.
+                ReportProgress(0, 0);
+            });
+    }
+
+    for (::std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+}
+
+void FRayTracingRenderer::ReportProgress(int32 RowNum, int64 SampleNum)
+{
+    // Only relaxed counters here. Printing is left to the reporter thread.
+    CompletedRowNum.fetch_add(RowNum, ::std::memory_order_relaxed);
+    CompletedSampleNum.fetch_add(SampleNum, ::std::memory_order_relaxed);
+    TracedRayNum.fetch_add(ThreadTracedRayNum, ::std::memory_order_relaxed);
+    ThreadTracedRayNum = 0;
 }
 
-void FRayTracingRenderer::UpdateProgressBar(float Val)
+void FRayTracingRenderer::SampleLight(FHitResult& OutHit, float& OutPdf, const FVector& Location, const FVector& Normal, float ULight,
+                                      const FVector2& UPoint)
 {
-    int32 BarWidth = 70;
+    if (EmissiveAliasTable.IsEmpty())
+    {
+        OutPdf = 0.0f;
+        return;
+    }
+
+    float PMF = 0.0f;
+    int32 Index = 0;
+    if (LightBVH != nullptr)
+    {
+        // No light can reach a point facing away from all of them.
+        Index = LightBVH->Sample(Location, Normal, ULight, &PMF);
+        if (Index < 0)
+        {
+            OutPdf = 0.0f;
+            return;
+        }
+    }
+    else
+    {
+        // Pick a triangle proportionally to its area, then a uniform point on it: the pdf is 1 / EmissionArea.
+        Index = EmissiveAliasTable.Sample(ULight, &PMF);
+    }
+    EmissivePrimitives[Index]->Sample(OutHit, OutPdf, UPoint);
+    OutPdf *= PMF * (1.0f - GetEnvironmentLightProbability());
+}
+
+float FRayTracingRenderer::LightPDF(const FHitResult& LightHit, const FVector& Origin, const FVector& Normal) const
+{
+    if (EmissionArea <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // Solid angle pdf of SampleLight choosing LightHit, seen from Origin.
+    FVector LightVector = LightHit.Location - Origin;
+    float CosB = FMath::Abs(FVector::DotProduct(LightVector.GetSafeNormal(), LightHit.Normal));
+    float AreaLightProbability = 1.0f - GetEnvironmentLightProbability();
+    if (LightBVH != nullptr)
+    {
+        float AreaPDF = LightBVH->PMF(Origin, Normal, LightHit.Object) / LightHit.Object->GetArea();
+        return CosB > 0.0f ? AreaPDF * LightVector.SquaredLength() / CosB * AreaLightProbability : 0.0f;
+    }
+    return CosB > 0.0f ? LightVector.SquaredLength() / (CosB * EmissionArea) * AreaLightProbability : 0.0f;
+}
+
+float FRayTracingRenderer::EnvironmentLightPDF(const FVector& Direction) const
+{
+    float EnvironmentProbability = GetEnvironmentLightProbability();
+    return EnvironmentProbability > 0.0f ? EnvironmentProbability * EnvironmentLight->PDF(Direction) : 0.0f;
+}
+
+float FRayTracingRenderer::GetEnvironmentLightProbability() const
+{
+    // Even odds when there are both, as a bright sky and a bright lamp are equally likely.
+    if (EnvironmentLight == nullptr || !EnvironmentLight->IsValid())
+    {
+        return 0.0f;
+    }
+    return EmissiveAliasTable.IsEmpty() ? 1.0f : 0.5f;
+}
+
+FVector FRayTracingRenderer::GetEnvironmentRadiance(const FVector& Direction) const
+{
+    return EnvironmentLight != nullptr ? EnvironmentLight->Evaluate(Direction) : FVector::ZeroVector;
+}
+
+FVector FRayTracingRenderer::GetEscapedRadiance(const FVector& Direction, float BSDFPDF) const
+{
+    // Without MIS the environment was already accounted for by light sampling.
+    float EnvironmentProbability = GetEnvironmentLightProbability();
+    if (EnvironmentProbability <= 0.0f)
+    {
+        return GetEnvironmentRadiance(Direction);
+    }
+    if (IntegratorType != EIntegratorType::MultipleImportanceSampling)
+    {
+        return FVector::ZeroVector;
+    }
+    return EnvironmentLight->Evaluate(Direction) * MISWeight(BSDFPDF, EnvironmentLightPDF(Direction));
+}
+
+float FRayTracingRenderer::MISWeight(float PDF, float OtherPDF) const
+{
+    if (MISHeuristic == EMISHeuristic::Power)
+    {
+        PDF *= PDF;
+        OtherPDF *= OtherPDF;
+    }
+    return PDF + OtherPDF > 0.0f ? PDF / (PDF + OtherPDF) : 0.0f;
+}
+
+// ********************
+//      Progress
+// ********************
+
+void FRayTracingRenderer::StartProgressReporter(int32 TotalRowNum, int64 TotalSampleNum)
+{
+    CompletedRowNum = 0;
+    CompletedSampleNum = 0;
+    TracedRayNum = 0;
+    WavefrontStatistics = FWavefrontStatistics();
+    ProgressTotalRowNum = FMath::Max(TotalRowNum, 1);
+    ProgressTotalSampleNum = TotalSampleNum;
+    ProgressStartTime = GetTimeSeconds();
+
+    if (bReportProgress)
+    {
+        bReporterRunning = true;
+        ProgressReporter = ::std::thread(&FRayTracingRenderer::ProgressReporterThread, this);
+    }
+}
+
+void FRayTracingRenderer::AddWavefrontStatistics(const FWavefrontStatistics& Statistics)
+{
+    ::std::lock_guard<::std::mutex> Lock(StatisticsMutex);
+    WavefrontStatistics.Add(Statistics);
+}
+
+void FRayTracingRenderer::StopProgressReporter()
+{
+    if (ProgressReporter.joinable())
+    {
+        {
+            ::std::lock_guard<::std::mutex> Lock(ReporterMutex);
+            bReporterRunning = false;
+        }
+        ReporterCondition.notify_one();
+        ProgressReporter.join();
+    }
+}
+
+void FRayTracingRenderer::ProgressReporterThread()
+{
+    double LastTime = ProgressStartTime;
+    int64 LastRayNum = 0;
+
+    ::std::unique_lock<::std::mutex> Lock(ReporterMutex);
+    bool bRunning = true;
+    while (bRunning)
+    {
+        auto Interval = ::std::chrono::duration<double>(ProgressReportInterval);
+        bRunning = !ReporterCondition.wait_for(Lock, Interval, [this]() { return !bReporterRunning; });
+
+        double Now = GetTimeSeconds();
+        int64 RayNum = TracedRayNum.load(::std::memory_order_relaxed);
+        float Progress = FMath::Min((float)CompletedRowNum.load(::std::memory_order_relaxed) / ProgressTotalRowNum, 1.0f);
+
+        FProgressReport Report;
+        Report.Progress = bRunning ? Progress : 1.0f;
+        Report.CompletedSampleNum = CompletedSampleNum.load(::std::memory_order_relaxed);
+        Report.TotalSampleNum = ProgressTotalSampleNum;
+        Report.RaysPerSecond = Now > LastTime ? (RayNum - LastRayNum) / (Now - LastTime) : 0.0;
+        Report.ElapsedSeconds = Now - ProgressStartTime;
+        Report.RemainingSeconds = Progress > 0.0f ? Report.ElapsedSeconds * (1.0f - Progress) / Progress : 0.0;
+        if (!bRunning)
+        {
+            // The final line reports the average over the whole render.
+            Report.RaysPerSecond = Report.ElapsedSeconds > 0.0 ? RayNum / Report.ElapsedSeconds : 0.0;
+            Report.RemainingSeconds = 0.0;
+        }
+        UpdateProgressBar(Report);
+
+        LastTime = Now;
+        LastRayNum = RayNum;
+    }
+}
+
+void FRayTracingRenderer::UpdateProgressBar(const FProgressReport& Report)
+{
+    int32 BarWidth = 50;
 
     std::cout << "[";
-    int32 Position = static_cast<int32>(BarWidth * Val);
+    int32 Position = static_cast<int32>(BarWidth * Report.Progress);
     for (int32 i = 0; i < BarWidth; ++i)
     {
         if (i < Position)
@@ -215,6 +1426,11 @@ void FRayTracingRenderer::UpdateProgressBar(float Val)
             std::cout << " ";
         }
     }
-    std::cout << "] " << std::fixed << std::setprecision(2) << Val * 100.0f << "%\n";
+
+    int32 Remaining = (int32)Report.RemainingSeconds;
+    std::cout << "] " << std::fixed << std::setprecision(2) << Report.Progress * 100.0f << "% | " << std::setprecision(2)
+              << Report.RaysPerSecond * 1e-6 << " Mrays/s | " << Report.CompletedSampleNum << "/" << Report.TotalSampleNum
+              << " samples | ETA " << std::setfill('0') << std::setw(2) << Remaining / 3600 << ":" << std::setw(2)
+              << Remaining / 60 % 60 << ":" << std::setw(2) << Remaining % 60 << std::setfill(' ') << "\n";
     std::cout.flush();
 }
@@ -2,53 +2,400 @@
 
 #include "Render/Renderer.h"
 #include "Render/Camera.h"
+#include "RayTracing/Sampler.h"
+#include "Math/AliasTable.h"
+#include "Render/RayTracing/PixelStatistics.h"
+#include "Render/RayTracing/Denoiser.h"
+#include "Render/RayTracing/WavefrontIntegrator.h"
+#include "Render/RayTracing/IrradianceCache.h"
+#include "Render/ToneMapper.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 #include <mutex>
+#include <thread>
 
 struct FRay;
+struct FHitRecord;
+struct FRayCone;
 struct FHitResult;
+struct FRayPacket;
 class FBoundingVolumeHierarchy;
 class FGeometry;
+class FEnvironmentLight;
+class FLightBVH;
+
+enum class EIntegratorType
+{
+    // Light sampling for direct light, BSDF sampling for indirect light only.
+    NextEventEstimation,
+    // Light and BSDF sampling both reach the lights, weighted by multiple importance sampling.
+    MultipleImportanceSampling
+};
+
+enum class EMISHeuristic
+{
+    Balance,
+    Power
+};
+
+enum class ELightSamplingStrategy
+{
+    // Pick emissive triangles proportionally to their area, wherever the shading point is.
+    Area,
+    // Pick them by their estimated contribution at the shading point (FLightBVH). Pays off with many small lights.
+    LightBVH
+};
+
+struct FProgressReport
+{
+    float Progress = 0.0f;
+    int64 CompletedSampleNum = 0;
+    // Upper bound for adaptive renders, which may finish early.
+    int64 TotalSampleNum = 0;
+    double RaysPerSecond = 0.0;
+    double ElapsedSeconds = 0.0;
+    double RemainingSeconds = 0.0;
+};
+
+// Limits of RenderWithBudget, the render stops at whichever comes first. Zero turns the time or error limit off.
+struct FRenderBudget
+{
+    // Wall-clock time of the whole render. A pass is only started if it is expected to end within the budget.
+    double TimeSeconds = 0.0;
+    // Mean relative error over the image (FPixelStatistics::GetRelativeError).
+    float ErrorTarget = 0.0f;
+    int32 MaxSPP = 4096;
+};
+
+enum class ERenderStopReason
+{
+    SampleLimit,
+    TimeBudget,
+    ErrorTarget,
+    Cancelled
+};
+
+struct FRenderResult
+{
+    int32 SPP = 0;
+    double ElapsedSeconds = 0.0;
+    float MeanRelativeError = 0.0f;
+    ERenderStopReason StopReason = ERenderStopReason::SampleLimit;
+};
+
+enum class ETraceMode
+{
+    // Every thread follows one path at a time from the camera to its end.
+    PathByPath,
+    // Every thread keeps a queue of paths and advances all of them stage by stage (FWavefrontIntegrator).
+    Wavefront
+};
 
 class FRayTracingRenderer : public FRenderer
 {
+    friend class FWavefrontIntegrator;
+
 public:
+    // Called after every progressive pass. GetFrameBuffer holds the current estimate at that point.
+    using FProgressiveCallback = ::std::function<void(int32 AccumulatedSPP)>;
+
     FRayTracingRenderer(int32 InWidth, int32 InHeight, const FCamera& InCamera);
     ~FRayTracingRenderer();
 
     void AddMesh(FGeometry* Mesh);
+    // Light rays that leave the scene with this map. Not owned. Without one they see black.
+    void SetEnvironmentLight(const FEnvironmentLight* InEnvironmentLight) { EnvironmentLight = InEnvironmentLight; }
 
     void BuildBVH();
     void Render(int32 SPP, bool bMultiThread = true);
 
+    // Trace SPP samples per pixel into the frame buffer without presenting or saving the image.
+    void RenderImage(int32 SPP, bool bMultiThread = true);
+
+    // Add one sample per pixel per pass to the accumulation buffer until it holds MaxSPP samples or the render is cancelled.
+    // Calling it again resumes from the samples already accumulated. Returns the accumulated SPP.
+    int32 RenderProgressive(int32 MaxSPP, const FProgressiveCallback& Callback = nullptr, bool bMultiThread = true);
+
+    // Safe to call from any thread, including the progressive callback. The pass in flight is discarded.
+    void CancelRender() { bCancelRequested = true; }
+    void ResetAccumulation();
+    int32 GetAccumulatedSPP() const { return AccumulatedSPP; }
+
+    // Give every pixel MinSPP samples, then keep adding batches of MinSPP samples only to the tiles whose relative error
+    // is above ErrorThreshold, until they converge or reach MaxSPP. Like RenderProgressive it continues from the
+    // accumulated samples. Returns the largest SPP of any pixel.
+    int32 RenderAdaptive(int32 MinSPP, int32 MaxSPP, float ErrorThreshold, const FProgressiveCallback& Callback = nullptr,
+                         bool bMultiThread = true);
+
+    // Add one sample per pixel per pass until Budget runs out. Like RenderProgressive it continues from the accumulated
+    // samples, but the time budget counts from this call.
+    FRenderResult RenderWithBudget(const FRenderBudget& Budget, const FProgressiveCallback& Callback = nullptr, bool bMultiThread = true);
+
+    // Let Render use RenderWithBudget, with the smaller of SPP and Budget.MaxSPP as the sample limit. GetRenderResult
+    // tells what it achieved.
+    void SetRenderBudget(const FRenderBudget& InRenderBudget) { RenderBudget = InRenderBudget; }
+    const FRenderResult& GetRenderResult() const { return RenderResult; }
+
+    // Let Render use RenderAdaptive with SPP as the maximum. A threshold of zero renders every pixel with SPP samples.
+    void SetAdaptiveSampling(float InErrorThreshold, int32 InMinSPP = 16)
+    {
+        AdaptiveErrorThreshold = InErrorThreshold;
+        AdaptiveMinSPP = FMath::Max(InMinSPP, 2);
+    }
+
+    // Save the accumulated samples, the per-pixel sample counts and every setting that decides the random numbers.
+    // Samples only depend on the seed, the pixel and the sample index, so a render resumed from a checkpoint
+    // produces the same image as one that was never interrupted.
+    bool SaveCheckpoint(const FAString& FilePath) const;
+    // Fails and leaves the renderer untouched if the file is missing, truncated, or written for another resolution or with
+    // other sample settings.
+    bool LoadCheckpoint(const FAString& FilePath);
+
+    // Save a checkpoint every IntervalSeconds while rendering progressively, and when the render ends or is cancelled.
+    // Render also resumes from this file if it exists. An empty path turns checkpointing off.
+    void SetCheckpoint(const FAString& InFilePath, double InIntervalSeconds = 60.0)
+    {
+        CheckpointFilePath = InFilePath;
+        CheckpointInterval = InIntervalSeconds;
+    }
+
+    // Print progress, rays per second and the remaining time every IntervalSeconds from a separate thread.
+    // Turn it off for batch jobs.
+    void SetProgressReport(bool bInReportProgress, double InIntervalSeconds = 1.0)
+    {
+        bReportProgress = bInReportProgress;
+        ProgressReportInterval = InIntervalSeconds;
+    }
+
+    // Let Render present and save the denoised image.
+    void SetDenoise(bool bInDenoise) { bDenoise = bInDenoise; }
+
+    // Exposure and tone curve of the preview and of 8-bit output files.
+    void SetToneMapSettings(const FToneMapSettings& InToneMapSettings) { ToneMapSettings = InToneMapSettings; }
+
+    // Where Render saves the image, in the format of the extension: linear .pfm and .exr, or 8-bit sRGB .png and .ppm.
+    // Adaptive renders also save their sample count heatmap.
+    void SetOutputFile(const FAString& InOutputFilePath, const FAString& InSampleCountFilePath = "./RTSampleCount.png")
+    {
+        OutputFilePath = InOutputFilePath;
+        SampleCountFilePath = InSampleCountFilePath;
+    }
+    // Render without a window or a key press at the end, for batch jobs on machines without a display. With a positive
+    // PreviewInterval the current estimate is saved that often while rendering. SOFT_HEADLESS builds have no window at
+    // all and always render this way.
+    void SetHeadless(bool bInHeadless, double InPreviewInterval = 0.0)
+    {
+        bHeadless = bInHeadless;
+        PreviewInterval = InPreviewInterval;
+    }
+    void SetDenoiserSettings(const FDenoiserSettings& InDenoiserSettings) { DenoiserSettings = InDenoiserSettings; }
+
+    // Filter the current estimate with the first-hit features. FrameBuffer is left untouched.
+    void Denoise(TArray<FVector>& OutImage);
+
+    // Samples taken per pixel, mapped from blue (fewest) to red (most).
+    void GetSampleCountHeatmap(TArray<FVector>& OutHeatmap) const;
+    int64 GetTotalSampleCount() const;
+    // Relative error of the pixel means (FPixelStatistics::GetRelativeError), averaged over the pixels with two or more
+    // samples.
+    float GetMeanRelativeError() const;
+
+    void SetSamplerType(ESamplerType InSamplerType) { SamplerType = InSamplerType; }
+    void SetIntegratorType(EIntegratorType InIntegratorType) { IntegratorType = InIntegratorType; }
+    void SetMISHeuristic(EMISHeuristic InMISHeuristic) { MISHeuristic = InMISHeuristic; }
+    void SetTraceMode(ETraceMode InTraceMode) { TraceMode = InTraceMode; }
+    // Takes effect on the next BuildBVH.
+    void SetLightSamplingStrategy(ELightSamplingStrategy InLightSamplingStrategy) { LightSamplingStrategy = InLightSamplingStrategy; }
+    // Shade diffuse camera hits with indirect irradiance from a cache instead of tracing their diffuse bounces. Faster
+    // for mostly diffuse scenes, at a bias the error tolerance controls. Renders path by path while the cache is on.
+    // The cache is filled before the first pass, row by row at four points in every pixel, with the records added in
+    // the same order on any number of threads. The passes only read it, so the image does not depend on the thread
+    // count and a resumed render builds the same cache.
+    void SetIrradianceCaching(const FIrradianceCacheSettings& InIrradianceCacheSettings);
+    int32 GetIrradianceRecordNum() const { return IrradianceCache != nullptr ? IrradianceCache->GetRecordNum() : 0; }
+    // Wavefront mode only: sort secondary rays by direction and origin before tracing them. The image does not change.
+    void SetRaySorting(bool bInSortRays) { bSortRays = bInSortRays; }
+    // Stage timings of the last wavefront render.
+    const FWavefrontStatistics& GetWavefrontStatistics() const { return WavefrontStatistics; }
+
+    // Paths stop after MaxDepth bounces. From RouletteMinDepth on, Russian roulette ends them by their throughput.
+    void SetMaxDepth(int32 InMaxDepth) { MaxDepth = FMath::Max(InMaxDepth, 1); }
+    void SetRouletteMinDepth(int32 InRouletteMinDepth) { RouletteMinDepth = FMath::Max(InRouletteMinDepth, 1); }
+
+    // Every pixel sample draws its random numbers from this seed, its pixel index and its sample index.
+    void SetRandomSeed(uint32 InRandomSeed) { RandomSeed = InRandomSeed; }
+
     // const FColor* GetFrameBuffer() const { return FrameBuffer.data(); }
     const FVector* GetFrameBuffer() const { return FrameBuffer.data(); }
+    const FSurfaceFeatures* GetFeatureBuffer() const { return FeatureBuffer.data(); }
+
+    int32 GetWidth() const { return Width; }
+    int32 GetHeight() const { return Height; }
 
 private:
+    // Trace SPP more samples per pixel and add them to the accumulation buffer. False if cancelled.
+    bool RenderPass(int32 SPP, bool bMultiThread);
     void RenderThread(int32 Begin, int32 End, int32 SPP);
+    // Activate the tiles that still need samples. Returns the number of active pixels.
+    int32 UpdateActivePixels(int32 MaxSPP, float ErrorThreshold);
+    void UpdateCheckpoint(bool bForce);
+
+    FRay GenerateCameraRay(int32 Col, int32 Row, const FVector2& PixelOffset) const;
+
+    // Iterative path tracer: carries the path throughput instead of recursing once per bounce.
+    // OutFeatures receives the first-hit albedo, normal and depth for the denoiser.
+    FVector RayTracing(const FRay& Ray, FSampler& Sampler, FSurfaceFeatures& OutFeatures);
+    // Radiance leaving Hit towards Wo, from the Bounce-th vertex of a path on. Cone is the ray cone that reached Hit.
+    FVector TracePath(FHitResult Hit, FRayCone Cone, FVector Wo, FSampler& Sampler, int32 Bounce);
+
+    // Irradiance caching. The direct light is sampled as usual, the indirect light of the diffuse lobe comes from the
+    // cache and only the other lobes trace further.
+    FVector ShadeCached(const FHitResult& Hit, const FRayCone& Cone, const FVector& Wo, FSampler& Sampler);
+    // Create and fill the cache if it is on and not there yet. False if cancelled, which leaves no cache.
+    bool PrepareIrradianceCache(bool bMultiThread);
+    // Add the records for the camera hits at four points in every pixel.
+    bool PopulateIrradianceCache(bool bMultiThread);
+    // Trace the hemisphere above Hit for a new record, and return its irradiance. Cone is the ray cone leaving Hit,
+    // PixelWidth the width of a pixel there.
+    FVector ComputeIrradianceRecord(const FHitResult& Hit, const FRayCone& Cone, float PixelWidth, bool bMultiThread);
+
+    // Pieces of a bounce shared by both trace modes.
+    // Light sampling without the visibility test: OutLo counts only if OutShadowRay reaches OutLightDistance unoccluded.
+    // With bDiffuseCached, only the BSDF sample of the other lobes looks for lights, so the diffuse lobe's share of the
+    // light sample takes full weight.
+    bool SampleDirectLight(const FHitResult& Hit, const FVector& Wo, FSampler& Sampler, FVector& OutLo, FRay& OutShadowRay,
+                           float& OutLightDistance, bool bDiffuseCached = false);
+    // BSDF sampling, throughput update and Russian roulette at the Bounce-th vertex. False if the path ends here.
+    bool ScatterPath(const FHitResult& Hit, const FVector& Wo, int32 Bounce, float URoulette, const FVector2& UBSDF,
+                     FVector& InOutThroughput, FVector& OutWi, float& OutPDF) const;
+    void Trace(FHitResult& OutHit, const FRay& Ray);
+    // Traversal only: the surface interaction is built later, and only for the hits that need it.
+    void Trace(FHitRecord& OutRecord, const FRay& Ray);
+    // Closest hits of all rays in the packet, the same ones Trace finds.
+    void TracePacket(FRayPacket& Packet);
+    static void GetSurfaceInteraction(const FHitRecord& Record, FHitResult& OutHit);
+    // Look up the hit's textures, filtered over the width of Cone where the ray along Direction hit.
+    static void ResolveAlbedo(FHitResult& InOutHit, const FRayCone& Cone, const FVector& Direction);
+    bool IsOccluded(const FRay& ShadowRay, float Distance);
+    static bool IsOccluding(const FHitRecord& ObstacleHit, float Distance);
+    static void GetSurfaceFeatures(const FHitResult& Hit, FSurfaceFeatures& OutFeatures);
 
-    FVector RayTracing(const FRay& Ray, int32 Depth);
-    FVector Shade(const FHitResult& Hit, const FVector& Wo);
-    void SampleLight(FHitResult& OutHit, float& OutPdf);
+    // Pick an emissive triangle and a point on it for a surface at Location facing Normal (the geometric normal).
+    // OutPdf is per area, and includes the choice of the area lights.
+    void SampleLight(FHitResult& OutHit, float& OutPdf, const FVector& Location, const FVector& Normal, float ULight,
+                     const FVector2& UPoint);
+    // Solid angle pdfs of light sampling reaching LightHit from Origin on a surface facing Normal, or the environment
+    // along Direction.
+    float LightPDF(const FHitResult& LightHit, const FVector& Origin, const FVector& Normal) const;
+    float EnvironmentLightPDF(const FVector& Direction) const;
+    // Light samples go to the environment with this probability, and to the area lights otherwise.
+    float GetEnvironmentLightProbability() const;
+    // Radiance of the environment seen along Direction, black without one.
+    FVector GetEnvironmentRadiance(const FVector& Direction) const;
+    // The same for a ray that left the scene after a BSDF sample with solid angle pdf BSDFPDF, weighted against light sampling.
+    FVector GetEscapedRadiance(const FVector& Direction, float BSDFPDF) const;
+    float MISWeight(float PDF, float OtherPDF) const;
 
-    void UpdateProgressBar(float Val);
+    // Call Body for every index below Num, spread over the render threads by index. Body may only write what belongs to
+    // its index, so the result is the same on any number of threads.
+    void ParallelFor(int32 Num, bool bMultiThread, const ::std::function<void(int32 Index)>& Body);
+
+    // The reporter only reads the atomic counters, so render threads never wait for console output.
+    void StartProgressReporter(int32 TotalRowNum, int64 TotalSampleNum);
+    void ReportProgress(int32 RowNum, int64 SampleNum);
+    void StopProgressReporter();
+    void ProgressReporterThread();
+    void UpdateProgressBar(const FProgressReport& Report);
+    void AddWavefrontStatistics(const FWavefrontStatistics& Statistics);
 
 private:
     // Camera and meshes.
     FCamera Camera;
+    float CameraScale;
+    float AspectRatio;
+    // Angle a camera ray's pixel subtends: the spread of the ray cones of primary rays.
+    float PixelSpreadAngle;
     TArray<FGeometry*> Meshes;
 
-    // Render target.
+    // Emissive triangles of all meshes, sampled proportionally to their area or through the light BVH.
+    TArray<FGeometry*> EmissivePrimitives;
+    FAliasTable EmissiveAliasTable;
+    float EmissionArea = 0.0f;
+    FLightBVH* LightBVH = nullptr;
+    const FEnvironmentLight* EnvironmentLight = nullptr;
+
+    // Render target. FrameBuffer is the accumulated radiance divided by the sample count of each pixel.
     TArray<FVector> FrameBuffer;
+    TArray<FVector> AccumulationBuffer;
+    TArray<FVector> PassBuffer;
+    TArray<FPixelStatistics> PixelStatistics;
+    TArray<FPixelStatistics> PassStatistics;
+    // Per-pixel mean of the first-hit features, and their sums over the pass in flight.
+    TArray<FSurfaceFeatures> FeatureBuffer;
+    TArray<FSurfaceFeatures> PassFeatureBuffer;
+    // Pixels that receive samples in the next pass.
+    TArray<uint8> ActivePixels;
+    int32 AccumulatedSPP = 0;
+    ::std::atomic<bool> bCancelRequested = false;
 
     // Render setting.
     FBoundingVolumeHierarchy* BVH = nullptr;
-    float RussianRoulette = 0.8f;
+    FDenoiser* Denoiser = nullptr;
+    FDenoiserSettings DenoiserSettings;
+    bool bDenoise = false;
+    int32 MaxDepth = 16;
+    int32 RouletteMinDepth = 3;
+    ESamplerType SamplerType = ESamplerType::Sobol;
+    EIntegratorType IntegratorType = EIntegratorType::MultipleImportanceSampling;
+    EMISHeuristic MISHeuristic = EMISHeuristic::Power;
+    ETraceMode TraceMode = ETraceMode::PathByPath;
+    ELightSamplingStrategy LightSamplingStrategy = ELightSamplingStrategy::Area;
+    bool bSortRays = false;
+    uint32 RandomSeed = 0;
+    float AdaptiveErrorThreshold = 0.0f;
+    int32 AdaptiveMinSPP = 16;
+    // Relative errors are measured against means of at least this luminance.
+    static constexpr float MinErrorLuminance = 0.01f;
+    FRenderBudget RenderBudget;
+    FRenderResult RenderResult;
+    // Created and filled before the first pass with the cache on, and kept until the scene or the settings change.
+    FIrradianceCacheSettings IrradianceCacheSettings;
+    FIrradianceCache* IrradianceCache = nullptr;
+
+    // Output.
+    FAString OutputFilePath = "./RTImage.png";
+    FAString SampleCountFilePath = "./RTSampleCount.png";
+    bool bHeadless = false;
+    double PreviewInterval = 0.0;
+    FToneMapSettings ToneMapSettings;
+
+    // Checkpoint.
+    FAString CheckpointFilePath;
+    double CheckpointInterval = 60.0;
+    double LastCheckpointTime = 0.0;
     int32 Width;
     int32 Height;
 
     // Multi thread.
-    ::std::mutex Mutex;
     int32 RenderThreadCount;
-    int32 RowComplatedNum = 0;
+
+    // Progress. Render threads bump the counters once per row.
+    ::std::atomic<int32> CompletedRowNum = 0;
+    ::std::atomic<int64> CompletedSampleNum = 0;
+    ::std::atomic<int64> TracedRayNum = 0;
+    int32 ProgressTotalRowNum = 1;
+    int64 ProgressTotalSampleNum = 0;
+    double ProgressStartTime = 0.0;
+
+    bool bReportProgress = true;
+    double ProgressReportInterval = 1.0;
+    ::std::thread ProgressReporter;
+    ::std::mutex ReporterMutex;
+    ::std::condition_variable ReporterCondition;
+    bool bReporterRunning = false;
+
+    FWavefrontStatistics WavefrontStatistics;
+    ::std::mutex StatisticsMutex;
 };
@@ -0,0 +1,421 @@
+#include "Render/RayTracing/WavefrontIntegrator.h"
+#include "Render/RayTracing/RayTracingRenderer.h"
+#include "RayTracing/RayPacket.h"
+#include "RayTracing/Sampler.h"
+#include "RayTracing/BoundingVolumeHierarchy.h"
+#include "Material/Material.h"
+
+#include <algorithm>
+#include <chrono>
+
+static double GetTimeSeconds()
+{
+    return ::std::chrono::duration<double>(::std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Sort keys: 3 octant bits above an 18-bit Morton code, sorted in two 11-bit counting passes.
+static constexpr int32 MortonAxisBits = 6;
+static constexpr int32 RadixBits = 11;
+
+// Spread the low 10 bits of V so that two zero bits follow each of them.
+static uint32 ExpandBits(uint32 V)
+{
+    V = (V * 0x00010001u) & 0xFF0000FFu;
+    V = (V * 0x00000101u) & 0x0F00F00Fu;
+    V = (V * 0x00000011u) & 0xC30C30C3u;
+    V = (V * 0x00000005u) & 0x49249249u;
+    return V;
+}
+
+void FWavefrontPaths::Resize(int32 Capacity)
+{
+    ::std::size_t Size = (::std::size_t)Capacity;
+    PixelIndex.resize(Size);
+    SampleIndex.resize(Size);
+    Dimension.resize(Size);
+    Rays.resize(Size);
+    Cones.resize(Size);
+    Bounce.resize(Size);
+    BSDFPDF.resize(Size);
+    SurfaceNormal.resize(Size);
+    Hits.resize(Size);
+    Throughput.resize(Size);
+    Radiance.resize(Size);
+    Features.resize(Size);
+}
+
+void FWavefrontShadowRays::Resize(int32 Capacity)
+{
+    ::std::size_t Size = (::std::size_t)Capacity;
+    PathIndex.resize(Size);
+    Rays.resize(Size);
+    Distance.resize(Size);
+    Radiance.resize(Size);
+}
+
+FWavefrontIntegrator::FWavefrontIntegrator(FRayTracingRenderer& InRenderer) : Renderer(InRenderer)
+{
+    // One sampler serves every path of the thread: each stage restarts it at the path's own sample and dimension.
+    Sampler = FSampler::Create(Renderer.SamplerType, Renderer.RandomSeed, Renderer.Width);
+
+    Paths.Resize(WavefrontSize);
+    ShadowRays.Resize(WavefrontSize);
+    ActivePaths.reserve(WavefrontSize);
+    NextActivePaths.reserve(WavefrontSize);
+
+    if (Renderer.bSortRays)
+    {
+        SortKeys.resize(WavefrontSize);
+        SortScratch.resize(WavefrontSize);
+
+        FBoundingBox SceneBounds = Renderer.BVH->GetBoundingBox();
+        FVector Extent = SceneBounds.Diagonal();
+        float CellNum = (float)((1 << MortonAxisBits) - 1);
+        SceneMin = SceneBounds.MinPoint;
+        SceneScale = FVector(Extent.X > 0.0f ? CellNum / Extent.X : 0.0f, //
+                             Extent.Y > 0.0f ? CellNum / Extent.Y : 0.0f, //
+                             Extent.Z > 0.0f ? CellNum / Extent.Z : 0.0f);
+    }
+}
+
+FWavefrontIntegrator::~FWavefrontIntegrator()
+{
+    if (Sampler != nullptr)
+    {
+        delete Sampler;
+        Sampler = nullptr;
+    }
+}
+
+void FWavefrontIntegrator::RenderRows(int32 BeginRow, int32 EndRow, int32 SPP)
+{
+    int32 Width = Renderer.Width;
+
+    // A wavefront holds all SPP samples of a block of pixels, or a batch of the samples of one pixel if SPP is large.
+    int32 BatchSPP = FMath::Min(SPP, WavefrontSize);
+    int32 ChunkPixelNum = FMath::Max(WavefrontSize / BatchSPP, 1);
+
+    TArray<int32> Pixels;
+    TArray<FVector> Colors((::std::size_t)ChunkPixelNum);
+    TArray<FPixelStatistics> Statistics((::std::size_t)ChunkPixelNum);
+    TArray<FSurfaceFeatures> FeatureSums((::std::size_t)ChunkPixelNum);
+    Pixels.reserve((::std::size_t)ChunkPixelNum);
+
+    int32 PixelEnd = EndRow * Width;
+    int32 CompletedRow = BeginRow;
+    for (int32 ChunkBegin = BeginRow * Width; ChunkBegin < PixelEnd && !Renderer.bCancelRequested;)
+    {
+        // The next ChunkPixelNum active pixels.
+        Pixels.clear();
+        int32 ChunkEnd = ChunkBegin;
+        for (; ChunkEnd < PixelEnd && (int32)Pixels.size() < ChunkPixelNum; ++ChunkEnd)
+        {
+            if (Renderer.ActivePixels[ChunkEnd])
+            {
+                Pixels.emplace_back(ChunkEnd);
+            }
+        }
+
+        int32 LocalPixelNum = (int32)Pixels.size();
+        ::std::fill(Colors.begin(), Colors.begin() + LocalPixelNum, FVector::ZeroVector);
+        ::std::fill(Statistics.begin(), Statistics.begin() + LocalPixelNum, FPixelStatistics());
+        ::std::fill(FeatureSums.begin(), FeatureSums.begin() + LocalPixelNum, FSurfaceFeatures());
+
+        for (int32 SampleBegin = 0; SampleBegin < SPP && LocalPixelNum > 0; SampleBegin += BatchSPP)
+        {
+            int32 SampleNum = FMath::Min(BatchSPP, SPP - SampleBegin);
+
+            GeneratePaths(Pixels, SampleBegin, SampleNum);
+            // All paths of a wavefront are at the same bounce.
+            for (int32 Bounce = 0; !ActivePaths.empty(); ++Bounce)
+            {
+                if (Bounce == 0)
+                {
+                    IntersectPaths(true);
+                }
+                else
+                {
+                    // Secondary rays leave in all directions, so they are the ones worth sorting.
+                    double SortStart = GetTimeSeconds();
+                    if (Renderer.bSortRays)
+                    {
+                        SortPaths();
+                    }
+                    double TraceStart = GetTimeSeconds();
+                    IntersectPaths(false);
+
+                    StageStatistics.SortSeconds += TraceStart - SortStart;
+                    StageStatistics.SecondaryTraceSeconds += GetTimeSeconds() - TraceStart;
+                    StageStatistics.SecondaryRayNum += (int64)ActivePaths.size();
+                }
+                ShadePaths();
+                TraceShadowRays(Bounce == 0);
+            }
+
+            // Slots are ordered by pixel, then by sample, so every pixel adds its samples in the path-by-path order.
+            for (int32 Slot = 0; Slot < PathNum; ++Slot)
+            {
+                int32 LocalPixel = Slot / SampleNum;
+                Colors[LocalPixel] += Paths.Radiance[Slot];
+                Statistics[LocalPixel].Add(Paths.Radiance[Slot]);
+                FeatureSums[LocalPixel].Albedo += Paths.Features[Slot].Albedo;
+                FeatureSums[LocalPixel].Normal += Paths.Features[Slot].Normal;
+                FeatureSums[LocalPixel].Depth += Paths.Features[Slot].Depth;
+            }
+        }
+
+        for (int32 LocalPixel = 0; LocalPixel < LocalPixelNum; ++LocalPixel)
+        {
+            int32 PixelIndex = Pixels[LocalPixel];
+            Renderer.PassBuffer[PixelIndex] = Colors[LocalPixel];
+            Renderer.PassStatistics[PixelIndex] = Statistics[LocalPixel];
+            Renderer.PassFeatureBuffer[PixelIndex] = FeatureSums[LocalPixel];
+        }
+
+        Renderer.ReportProgress(ChunkEnd / Width - CompletedRow, (int64)LocalPixelNum * SPP);
+        CompletedRow = ChunkEnd / Width;
+        ChunkBegin = ChunkEnd;
+    }
+
+    Renderer.AddWavefrontStatistics(StageStatistics);
+}
+
+void FWavefrontIntegrator::GeneratePaths(const TArray<int32>& Pixels, int32 SampleBegin, int32 SampleNum)
+{
+    int32 Width = Renderer.Width;
+
+    PathNum = 0;
+    ActivePaths.clear();
+    for (int32 PixelIndex : Pixels)
+    {
+        int32 X = PixelIndex % Width;
+        int32 Y = PixelIndex / Width;
+        int32 FirstSampleIndex = Renderer.PixelStatistics[PixelIndex].SampleCount + SampleBegin;
+
+        for (int32 SampleIndex = FirstSampleIndex; SampleIndex < FirstSampleIndex + SampleNum; ++SampleIndex)
+        {
+            int32 Slot = PathNum++;
+
+            Sampler->StartPixelSample(X, Y, SampleIndex);
+            Paths.Rays[Slot] = Renderer.GenerateCameraRay(X, Y, Sampler->Get2D());
+            Paths.Cones[Slot] = FRayCone(0.0f, Renderer.PixelSpreadAngle);
+
+            Paths.PixelIndex[Slot] = PixelIndex;
+            Paths.SampleIndex[Slot] = SampleIndex;
+            Paths.Dimension[Slot] = Sampler->GetDimension();
+            Paths.Bounce[Slot] = 0;
+            Paths.BSDFPDF[Slot] = 0.0f;
+            Paths.Throughput[Slot] = FVector(1.0f);
+            Paths.Radiance[Slot] = FVector::ZeroVector;
+            Paths.Features[Slot] = FSurfaceFeatures();
+
+            ActivePaths.emplace_back(Slot);
+        }
+    }
+}
+
+void FWavefrontIntegrator::IntersectPaths(bool bPackets)
+{
+    if (!bPackets)
+    {
+        for (int32 Slot : ActivePaths)
+        {
+            Paths.Hits[Slot] = FHitRecord();
+            Renderer.Trace(Paths.Hits[Slot], Paths.Rays[Slot]);
+        }
+        return;
+    }
+
+    // Slots are ordered by pixel, so consecutive paths start from neighbouring pixels.
+    int32 ActivePathNum = (int32)ActivePaths.size();
+    for (int32 Begin = 0; Begin < ActivePathNum; Begin += RayPacketSize)
+    {
+        int32 End = FMath::Min(Begin + RayPacketSize, ActivePathNum);
+
+        Packet.Clear();
+        for (int32 Index = Begin; Index < End; ++Index)
+        {
+            Packet.AddRay(Paths.Rays[ActivePaths[Index]]);
+        }
+        Packet.Finalize();
+        Renderer.TracePacket(Packet);
+
+        for (int32 Index = Begin; Index < End; ++Index)
+        {
+            Paths.Hits[ActivePaths[Index]] = Packet.Hits[Index - Begin];
+        }
+    }
+}
+
+void FWavefrontIntegrator::SortPaths()
+{
+    int32 ActivePathNum = (int32)ActivePaths.size();
+    float MaxCell = (float)((1 << MortonAxisBits) - 1);
+    for (int32 Index = 0; Index < ActivePathNum; ++Index)
+    {
+        const FRay& Ray = Paths.Rays[ActivePaths[Index]];
+        uint32 Octant = (Ray.Direction.X < 0.0f ? 4u : 0u) | (Ray.Direction.Y < 0.0f ? 2u : 0u) | (Ray.Direction.Z < 0.0f ? 1u : 0u);
+
+        FVector Cell = (Ray.Origin - SceneMin) * SceneScale;
+        uint32 X = (uint32)FMath::Clamp(Cell.X, 0.0f, MaxCell);
+        uint32 Y = (uint32)FMath::Clamp(Cell.Y, 0.0f, MaxCell);
+        uint32 Z = (uint32)FMath::Clamp(Cell.Z, 0.0f, MaxCell);
+        uint32 Morton = (ExpandBits(X) << 2) | (ExpandBits(Y) << 1) | ExpandBits(Z);
+
+        uint32 Key = (Octant << (3 * MortonAxisBits)) | Morton;
+        SortKeys[Index] = ((uint64)Key << 32) | (uint32)ActivePaths[Index];
+    }
+
+    // LSD radix sort: linear in the path count, unlike a comparison sort.
+    uint32 Counts[1 << RadixBits];
+    for (int32 Shift = 32; Shift < 32 + 3 * MortonAxisBits + 3; Shift += RadixBits)
+    {
+        ::std::fill(::std::begin(Counts), ::std::end(Counts), 0u);
+        for (int32 Index = 0; Index < ActivePathNum; ++Index)
+        {
+            ++Counts[(SortKeys[Index] >> Shift) & ((1u << RadixBits) - 1)];
+        }
+
+        uint32 Offset = 0;
+        for (uint32& Count : Counts)
+        {
+            uint32 Next = Offset + Count;
+            Count = Offset;
+            Offset = Next;
+        }
+
+        for (int32 Index = 0; Index < ActivePathNum; ++Index)
+        {
+            SortScratch[Counts[(SortKeys[Index] >> Shift) & ((1u << RadixBits) - 1)]++] = SortKeys[Index];
+        }
+        SortKeys.swap(SortScratch);
+    }
+
+    for (int32 Index = 0; Index < ActivePathNum; ++Index)
+    {
+        ActivePaths[Index] = (int32)(SortKeys[Index] & 0xFFFFFFFFu);
+    }
+}
+
+void FWavefrontIntegrator::ShadePaths()
+{
+    int32 Width = Renderer.Width;
+    bool bMIS = Renderer.IntegratorType == EIntegratorType::MultipleImportanceSampling;
+
+    ShadowRays.Num = 0;
+    NextActivePaths.clear();
+    for (int32 Slot : ActivePaths)
+    {
+        if (!Paths.Hits[Slot].IsHit())
+        {
+            // Seen directly, or reached by a BSDF sample.
+            const FVector& Direction = Paths.Rays[Slot].Direction;
+            if (Paths.Bounce[Slot] == 0)
+            {
+                Paths.Radiance[Slot] += Renderer.GetEnvironmentRadiance(Direction);
+            }
+            else
+            {
+                Paths.Radiance[Slot] += Paths.Throughput[Slot] * Renderer.GetEscapedRadiance(Direction, Paths.BSDFPDF[Slot]);
+            }
+            continue;
+        }
+        FHitResult Hit;
+        FRayTracingRenderer::GetSurfaceInteraction(Paths.Hits[Slot], Hit);
+        FRayTracingRenderer::ResolveAlbedo(Hit, Paths.Cones[Slot], Paths.Rays[Slot].Direction);
+
+        int32 Bounce = Paths.Bounce[Slot];
+        if (Bounce == 0)
+        {
+            FRayTracingRenderer::GetSurfaceFeatures(Hit, Paths.Features[Slot]);
+        }
+
+        if (Hit.Material->IsEmission())
+        {
+            if (Bounce == 0)
+            {
+                Paths.Radiance[Slot] += Hit.Material->Emission;
+            }
+            else if (bMIS)
+            {
+                // Without MIS the light was already accounted for by light sampling.
+                float LightPDF = Renderer.LightPDF(Hit, Paths.Rays[Slot].Origin, Paths.SurfaceNormal[Slot]);
+                float Weight = Renderer.MISWeight(Paths.BSDFPDF[Slot], LightPDF);
+                Paths.Radiance[Slot] += Paths.Throughput[Slot] * Hit.Material->Emission * Weight;
+            }
+            continue;
+        }
+
+        int32 PixelIndex = Paths.PixelIndex[Slot];
+        Sampler->StartPixelSample(PixelIndex % Width, PixelIndex / Width, Paths.SampleIndex[Slot], Paths.Dimension[Slot]);
+
+        // Light sampling. The visibility test is deferred to the shadow stage.
+        FVector Wo = -Paths.Rays[Slot].Direction;
+        FVector LoDirect;
+        FRay ShadowRay;
+        float LightDistance = 0.0f;
+        if (Renderer.SampleDirectLight(Hit, Wo, *Sampler, LoDirect, ShadowRay, LightDistance))
+        {
+            int32 ShadowIndex = ShadowRays.Num++;
+            ShadowRays.PathIndex[ShadowIndex] = Slot;
+            ShadowRays.Rays[ShadowIndex] = ShadowRay;
+            ShadowRays.Distance[ShadowIndex] = LightDistance;
+            ShadowRays.Radiance[ShadowIndex] = Paths.Throughput[Slot] * LoDirect;
+        }
+
+        // Draw the roulette and BSDF dimensions even if they end up unused, so every bounce consumes the same dimensions.
+        float URoulette = Sampler->Get1D();
+        FVector2 UBSDF = Sampler->Get2D();
+        Paths.Dimension[Slot] = Sampler->GetDimension();
+
+        FVector Wi;
+        float PDF = 0.0f;
+        if (Renderer.ScatterPath(Hit, Wo, Bounce, URoulette, UBSDF, Paths.Throughput[Slot], Wi, PDF))
+        {
+            Paths.Rays[Slot] = FRay::SpawnFromSurface(Hit.Location, Hit.Normal, Wi);
+            Paths.Cones[Slot] = Paths.Cones[Slot].Bounce(Hit.Time, Hit.Material->GetSpreadAngle());
+            Paths.Bounce[Slot] = Bounce + 1;
+            Paths.BSDFPDF[Slot] = PDF;
+            Paths.SurfaceNormal[Slot] = Hit.Normal;
+            NextActivePaths.emplace_back(Slot);
+        }
+    }
+
+    ActivePaths.swap(NextActivePaths);
+}
+
+void FWavefrontIntegrator::TraceShadowRays(bool bPackets)
+{
+    if (!bPackets)
+    {
+        for (int32 ShadowIndex = 0; ShadowIndex < ShadowRays.Num; ++ShadowIndex)
+        {
+            if (!Renderer.IsOccluded(ShadowRays.Rays[ShadowIndex], ShadowRays.Distance[ShadowIndex]))
+            {
+                Paths.Radiance[ShadowRays.PathIndex[ShadowIndex]] += ShadowRays.Radiance[ShadowIndex];
+            }
+        }
+        return;
+    }
+
+    for (int32 Begin = 0; Begin < ShadowRays.Num; Begin += RayPacketSize)
+    {
+        int32 End = FMath::Min(Begin + RayPacketSize, ShadowRays.Num);
+
+        Packet.Clear();
+        for (int32 ShadowIndex = Begin; ShadowIndex < End; ++ShadowIndex)
+        {
+            Packet.AddRay(ShadowRays.Rays[ShadowIndex]);
+        }
+        Packet.Finalize();
+        Renderer.TracePacket(Packet);
+
+        for (int32 ShadowIndex = Begin; ShadowIndex < End; ++ShadowIndex)
+        {
+            if (!FRayTracingRenderer::IsOccluding(Packet.Hits[ShadowIndex - Begin], ShadowRays.Distance[ShadowIndex]))
+            {
+                Paths.Radiance[ShadowRays.PathIndex[ShadowIndex]] += ShadowRays.Radiance[ShadowIndex];
+            }
+        }
+    }
+}
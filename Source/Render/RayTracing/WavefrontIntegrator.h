@@ -0,0 +1,119 @@
+#pragma once
+
+#include "CoreTypes.h"
+#include "RayTracing/HitResult.h"
+#include "RayTracing/Ray.h"
+#include "RayTracing/RayPacket.h"
+#include "Render/RayTracing/PixelStatistics.h"
+#include "Render/RayTracing/Denoiser.h"
+
+class FRayTracingRenderer;
+class FSampler;
+
+// State of the paths in one wavefront, one array per field. A path keeps its slot until the wavefront is done.
+struct FWavefrontPaths
+{
+    void Resize(int32 Capacity);
+
+    // Which pixel sample the path belongs to, and how far its sampler has advanced.
+    TArray<int32> PixelIndex;
+    TArray<int32> SampleIndex;
+    TArray<int32> Dimension;
+
+    // The ray to trace next, and the vertex it leaves from (0 for camera rays).
+    TArray<FRay> Rays;
+    TArray<FRayCone> Cones;
+    TArray<int32> Bounce;
+    // Solid angle pdf of the BSDF sample that produced the ray, and the geometric normal where it was taken, for the MIS
+    // weight of an emitter it hits.
+    TArray<float> BSDFPDF;
+    TArray<FVector> SurfaceNormal;
+
+    // Only what traversal found. The shade stage builds the surface interaction of the live paths.
+    TArray<FHitRecord> Hits;
+    TArray<FVector> Throughput;
+    TArray<FVector> Radiance;
+    TArray<FSurfaceFeatures> Features;
+};
+
+// Shadow rays of one shade stage, with the radiance they add to their path if the light is visible.
+struct FWavefrontShadowRays
+{
+    void Resize(int32 Capacity);
+
+    int32 Num = 0;
+    TArray<int32> PathIndex;
+    TArray<FRay> Rays;
+    TArray<float> Distance;
+    TArray<FVector> Radiance;
+};
+
+// Where the time of the wavefront stages goes, summed over all render threads.
+struct FWavefrontStatistics
+{
+    // Rays traced after the first bounce, where the ray order decides how randomly the BVH is accessed.
+    int64 SecondaryRayNum = 0;
+    double SecondaryTraceSeconds = 0.0;
+    double SortSeconds = 0.0;
+
+    void Add(const FWavefrontStatistics& Other)
+    {
+        SecondaryRayNum += Other.SecondaryRayNum;
+        SecondaryTraceSeconds += Other.SecondaryTraceSeconds;
+        SortSeconds += Other.SortSeconds;
+    }
+
+    // Per thread. Sorting pays off if it raises this by more than its own time costs.
+    double GetSecondaryRaysPerSecond() const { return SecondaryTraceSeconds > 0.0 ? SecondaryRayNum / SecondaryTraceSeconds : 0.0; }
+};
+
+// Wavefront path tracing (Laine et al. 2013, "Megakernels Considered Harmful: Wavefront Path Tracing on GPUs").
+// Instead of following one path to its end, a thread fills a queue with the paths of a block of pixel samples and
+// advances all of them one stage at a time: intersect, shade (light sampling and BSDF sampling), shadow test.
+// Each stage is a tight loop over the queue, so BVH traversal and material code stay hot in the caches.
+// Paths draw exactly the same random numbers as in the path-by-path mode, and pixels are accumulated in the same
+// sample order, so both modes produce the same image.
+class FWavefrontIntegrator
+{
+public:
+    FWavefrontIntegrator(FRayTracingRenderer& InRenderer);
+    ~FWavefrontIntegrator();
+
+    // Trace SPP samples for the active pixels of rows [BeginRow, EndRow) into the renderer's pass buffers.
+    void RenderRows(int32 BeginRow, int32 EndRow, int32 SPP);
+
+private:
+    // Start SampleNum paths for every pixel in Pixels, from the pixels' FirstSampleIndex + SampleBegin on.
+    void GeneratePaths(const TArray<int32>& Pixels, int32 SampleBegin, int32 SampleNum);
+    // Coherent rays (camera rays and the shadow rays of their hits) are traced in packets, the rest one by one.
+    void IntersectPaths(bool bPackets);
+    void ShadePaths();
+    void TraceShadowRays(bool bPackets);
+
+    // Reorder the active paths by ray direction octant, then by the Morton code of the ray origin, so that rays traced
+    // one after the other visit the same BVH nodes. Only the order changes: every path keeps its slot.
+    void SortPaths();
+
+private:
+    static constexpr int32 WavefrontSize = 4096;
+
+    FRayTracingRenderer& Renderer;
+    FSampler* Sampler = nullptr;
+
+    FWavefrontPaths Paths;
+    FWavefrontShadowRays ShadowRays;
+    int32 PathNum = 0;
+    FRayPacket Packet;
+
+    // Slots of the paths still alive, compacted after every shade stage.
+    TArray<int32> ActivePaths;
+    TArray<int32> NextActivePaths;
+
+    // Sort keys in the high 32 bits, slots in the low ones. Origins are quantized inside the scene bounds.
+    TArray<uint64> SortKeys;
+    TArray<uint64> SortScratch;
+    FVector SceneMin;
+    FVector SceneScale;
+
+    FWavefrontStatistics StageStatistics;
+};
@@ -0,0 +1,106 @@
+#include "Render/ToneMapper.h"
+#include "Math/MathSSE.h"
+
+using namespace Math::SSE;
+
+static FORCEINLINE __m128 ACESCurve(const __m128& X)
+{
+    __m128 Numerator = _mm_mul_ps(X, _mm_add_ps(_mm_mul_ps(X, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+    __m128 Denominator = _mm_add_ps(_mm_mul_ps(X, _mm_add_ps(_mm_mul_ps(X, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+    return _mm_div_ps(Numerator, Denominator);
+}
+
+// Tone map four pixels given as channel planes, and pack them to sRGB BGRA.
+static FORCEINLINE void ToneMap4(EToneMapOperator Operator, const __m128& Scale, __m128 R, __m128 G, __m128 B, FColor* OutPixels)
+{
+    R = _mm_mul_ps(R, Scale);
+    G = _mm_mul_ps(G, Scale);
+    B = _mm_mul_ps(B, Scale);
+
+    switch (Operator)
+    {
+    case EToneMapOperator::Reinhard:
+    {
+        __m128 Luminance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(R, _mm_set1_ps(0.2126f)), _mm_mul_ps(G, _mm_set1_ps(0.7152f))),
+                                      _mm_mul_ps(B, _mm_set1_ps(0.0722f)));
+        __m128 Ratio = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_set1_ps(1.0f), Luminance));
+        R = _mm_mul_ps(R, Ratio);
+        G = _mm_mul_ps(G, Ratio);
+        B = _mm_mul_ps(B, Ratio);
+        break;
+    }
+    case EToneMapOperator::ACES:
+        R = ACESCurve(R);
+        G = ACESCurve(G);
+        B = ACESCurve(B);
+        break;
+    default:
+        // ConvertLinearToSRGB clamps.
+        break;
+    }
+
+    __m128i Packed = _mm_or_si128(ConvertLinearToSRGB(B), _mm_slli_epi32(ConvertLinearToSRGB(G), 8));
+    Packed = _mm_or_si128(Packed, _mm_slli_epi32(ConvertLinearToSRGB(R), 16));
+    Packed = _mm_or_si128(Packed, _mm_set1_epi32((int)0xFF000000));
+    _mm_storeu_si128((__m128i*)OutPixels, Packed);
+}
+
+static FORCEINLINE void Load4(const FVector* Pixels, __m128& OutR, __m128& OutG, __m128& OutB)
+{
+    OutR = _mm_setr_ps(Pixels[0].X, Pixels[1].X, Pixels[2].X, Pixels[3].X);
+    OutG = _mm_setr_ps(Pixels[0].Y, Pixels[1].Y, Pixels[2].Y, Pixels[3].Y);
+    OutB = _mm_setr_ps(Pixels[0].Z, Pixels[1].Z, Pixels[2].Z, Pixels[3].Z);
+}
+
+static FORCEINLINE void Load4(const FLinearColor* Pixels, __m128& OutR, __m128& OutG, __m128& OutB)
+{
+    __m128 P0 = VectorLoad(Pixels[0].RGBA);
+    __m128 P1 = VectorLoad(Pixels[1].RGBA);
+    __m128 P2 = VectorLoad(Pixels[2].RGBA);
+    __m128 P3 = VectorLoad(Pixels[3].RGBA);
+    _MM_TRANSPOSE4_PS(P0, P1, P2, P3);
+    OutR = P0;
+    OutG = P1;
+    OutB = P2;
+}
+
+template <typename PixelType>
+static void ApplyInternal(const FToneMapSettings& Settings, const PixelType* Pixels, FColor* OutPixels, int32 PixelNum)
+{
+    const __m128 Scale = _mm_set1_ps(FMath::Pow(2.0f, Settings.Exposure));
+    __m128 R, G, B;
+
+    int32 Index = 0;
+    for (; Index + 4 <= PixelNum; Index += 4)
+    {
+        Load4(Pixels + Index, R, G, B);
+        ToneMap4(Settings.Operator, Scale, R, G, B, OutPixels + Index);
+    }
+
+    // The last one to three pixels. Unused lanes repeat the first of them.
+    if (Index < PixelNum)
+    {
+        PixelType Tail[4];
+        FColor OutTail[4];
+        for (int32 i = 0; i < 4; ++i)
+        {
+            Tail[i] = Pixels[Index + (Index + i < PixelNum ? i : 0)];
+        }
+        Load4(Tail, R, G, B);
+        ToneMap4(Settings.Operator, Scale, R, G, B, OutTail);
+        for (int32 i = 0; i < PixelNum - Index; ++i)
+        {
+            OutPixels[Index + i] = OutTail[i];
+        }
+    }
+}
+
+void FToneMapper::Apply(const FToneMapSettings& Settings, const FVector* Pixels, FColor* OutPixels, int32 PixelNum)
+{
+    ApplyInternal(Settings, Pixels, OutPixels, PixelNum);
+}
+
+void FToneMapper::Apply(const FToneMapSettings& Settings, const FLinearColor* Pixels, FColor* OutPixels, int32 PixelNum)
+{
+    ApplyInternal(Settings, Pixels, OutPixels, PixelNum);
+}
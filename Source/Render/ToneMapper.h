@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+enum class EToneMapOperator
+{
+    // Clamp to [0, 1].
+    Clamp,
+    // L / (1 + L) on the luminance, keeping the hue (Reinhard et al. 2002).
+    Reinhard,
+    // Narkowicz's fit of the ACES filmic curve, per channel.
+    ACES
+};
+
+struct FToneMapSettings
+{
+    EToneMapOperator Operator = EToneMapOperator::Clamp;
+    // In stops: the radiance is scaled by 2^Exposure before the curve.
+    float Exposure = 0.0f;
+};
+
+// Output stage from linear radiance to 8-bit sRGB, run once over a whole frame. Four pixels go through the exposure, the
+// curve and Math::SSE::ConvertLinearToSRGB together. Results are packed like FLinearColor::ToFColorSRGB (BGRA), with
+// an opaque alpha.
+class FToneMapper
+{
+public:
+    static void Apply(const FToneMapSettings& Settings, const FVector* Pixels, FColor* OutPixels, int32 PixelNum);
+    static void Apply(const FToneMapSettings& Settings, const FLinearColor* Pixels, FColor* OutPixels, int32 PixelNum);
+};